@@ -0,0 +1,647 @@
+/**
+ * @file batched_matrix.hpp
+ * @brief Contains BatchedMatrix, many small sparse matrices with a common pattern stored as structure of arrays,
+ * and the batched solvers BatchedLU and bicgstab_batched.
+ *
+ * The values of entry k of all the items are contiguous (value of item b at k * batch + b), and so are the
+ * entries i of the batched vectors (x[i * batch + b], see pack_batch). Every kernel walks the pattern once
+ * and applies each operation to a tile of items with a vectorized loop; the tiles are split among threads.
+ * Nothing is parallelized or vectorized within a single tiny matrix.
+ */
+
+#ifndef BATCHED_MATRIX_HPP
+#define BATCHED_MATRIX_HPP
+
+#include "iterative_solvers.hpp"
+#include <set>
+#include <thread>
+
+namespace algebra {
+
+    /**
+     * @brief Runs kernel(first, last) on ranges of at most tile items covering [0, batch), splitting them among threads.
+     * Every range of a thread starts at a multiple of 8 items, so that two threads do not write the same cache line;
+     * the tiles keep the working set of the kernels (e.g. the factors or the vectors of a solver) in cache.
+     *
+     * @param batch Number of items
+     * @param threads Number of threads (at most one thread every 64 items is used)
+     * @param kernel Callable taking the first and the last (excluded) item of its range
+     * @param tile Maximum number of items of a range
+     */
+    template<typename Kernel>
+    void parallel_batch(std::size_t batch, std::size_t threads, Kernel&& kernel, std::size_t tile = 256){
+        threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(batch / 64, 1));
+        auto first = [batch, threads](std::size_t t){ return t == threads ? batch : batch * t / threads / 8 * 8;};
+        auto run = [&kernel, tile](std::size_t begin, std::size_t end){
+            for (std::size_t b = begin; b < end; b += tile) {
+                kernel(b, std::min(b + tile, end));
+            }
+        };
+        std::vector<std::thread> workers;
+        for (std::size_t t = 1; t < threads; ++t) {
+            workers.emplace_back(run, first(t), first(t + 1));
+        }
+        run(first(0), first(1));
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Default number of threads of the batched kernels
+     */
+    inline std::size_t default_batch_threads(){
+        return std::max<unsigned>(std::thread::hardware_concurrency(), 1);
+    }
+
+    /**
+     * @brief Packs the vectors of the items into a batched vector (entry i of item b at i * batch + b)
+     *
+     * @param items One vector per item, all of the same size
+     */
+    template<RealOrComplex T>
+    std::vector<T> pack_batch(const std::vector<std::vector<T>>& items){
+        const std::size_t batch = items.size();
+        const std::size_t n = batch > 0 ? items[0].size() : 0;
+        std::vector<T> packed(n * batch);
+        for (std::size_t b = 0; b < batch; ++b) {
+            if (items[b].size() != n) {
+                throw std::invalid_argument("The vectors of the batch must have the same size.");
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                packed[i * batch + b] = items[b][i];
+            }
+        }
+        return packed;
+    }
+
+    /**
+     * @brief Extracts the vector of one item from a batched vector
+     *
+     * @param packed The batched vector
+     * @param batch Number of items
+     * @param b The item
+     */
+    template<RealOrComplex T>
+    std::vector<T> unpack_item(std::span<const T> packed, std::size_t batch, std::size_t b){
+        if (b >= batch || packed.size() % batch != 0) {
+            throw std::out_of_range("Item out of the batch.");
+        }
+        std::vector<T> item(packed.size() / batch);
+        for (std::size_t i = 0; i < item.size(); ++i) {
+            item[i] = packed[i * batch + b];
+        }
+        return item;
+    }
+
+    /**
+     * @brief Batch of square or rectangular sparse matrices with the same sparsity pattern (stored by rows)
+     * and values stored by entry: the values of entry k of all the items are contiguous.
+     * Items with different patterns are stored on the union of their patterns, with explicit zeros.
+     *
+     * @tparam T The type of elements in the matrices
+     */
+    template<RealOrComplex T>
+    class BatchedMatrix {
+    public:
+        using Pattern = SparsityPattern<StorageOrder::RowOrdering>;
+
+        /**
+         * @brief Constructor: batch of matrices sharing a pattern, with all the values equal to 0
+         *
+         * @param pattern Sparsity pattern of the items (e.g. the pattern() of a Matrix)
+         * @param batch Number of items
+         */
+        BatchedMatrix(std::shared_ptr<const Pattern> pattern, std::size_t batch)
+            : shared_pattern(std::move(pattern)), batch(batch){
+            if (!shared_pattern) {
+                throw std::invalid_argument("The pattern must not be null.");
+            }
+            data.assign(shared_pattern->nonzeros() * batch, T{0});
+        }
+
+        /**
+         * @brief Constructor: copies the values of compressed matrices of the same size. If the matrices do not all
+         * share the pattern of the first one, the batch is stored on the union of the patterns.
+         *
+         * @param items The matrices, in compressed format with plain values
+         */
+        explicit BatchedMatrix(const std::vector<Matrix<T, StorageOrder::RowOrdering>>& items) : batch(items.size()){
+            if (items.empty()) {
+                throw std::invalid_argument("The batch must not be empty.");
+            }
+            for (const auto& item : items) {
+                if (!item.is_compressed()) {
+                    throw std::invalid_argument("The matrices must be compressed.");
+                }
+                if (item.rows() != items[0].rows() || item.cols() != items[0].cols()) {
+                    throw std::invalid_argument("The matrices of the batch must have the same size.");
+                }
+            }
+            const bool shared = std::all_of(items.begin(), items.end(), [&](const auto& item){ return same_pattern(item, items[0]);});
+            shared_pattern = shared ? items[0].pattern() : union_pattern(items);
+            data.assign(shared_pattern->nonzeros() * batch, T{0});
+            for (std::size_t b = 0; b < batch; ++b) {
+                set_item(b, items[b]);
+            }
+        }
+
+        /**
+         * @brief Copies the values of a compressed matrix into item b; its pattern must be contained in the batch pattern
+         */
+        void set_item(std::size_t b, const Matrix<T, StorageOrder::RowOrdering>& matrix){
+            if (b >= batch) {
+                throw std::out_of_range("Item out of the batch.");
+            }
+            if (matrix.rows() != rows() || matrix.cols() != cols()) {
+                throw std::invalid_argument("Matrix dimensions mismatch.");
+            }
+            auto inner = matrix.inner_index();
+            auto outer = matrix.outer_index();
+            auto values = matrix.values();
+            for (std::size_t i = 0; i < rows(); ++i) {
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    data[position(i, outer[k]) * batch + b] = values[k];
+                }
+            }
+        }
+
+        /**
+         * @brief Returns item b as a compressed Matrix sharing the batch pattern
+         */
+        Matrix<T, StorageOrder::RowOrdering> item(std::size_t b) const{
+            if (b >= batch) {
+                throw std::out_of_range("Item out of the batch.");
+            }
+            std::pmr::vector<T> values(nonzeros());
+            for (std::size_t k = 0; k < values.size(); ++k) {
+                values[k] = data[k * batch + b];
+            }
+            return Matrix<T, StorageOrder::RowOrdering>(shared_pattern, std::move(values));
+        }
+
+        /**
+         * @brief Access to the element (i, j) of item b, which must be in the pattern
+         */
+        T& operator()(std::size_t b, std::size_t i, std::size_t j){
+            if (b >= batch) {
+                throw std::out_of_range("Item out of the batch.");
+            }
+            return data[position(i, j) * batch + b];
+        }
+
+        /**
+         * @brief Const access to the element (i, j) of item b; returns 0 if it is not in the pattern
+         */
+        T operator()(std::size_t b, std::size_t i, std::size_t j) const{
+            if (b >= batch || i >= rows() || j >= cols()) {
+                throw std::out_of_range("Index out of boundary");
+            }
+            auto columns = shared_pattern->outer_index();
+            auto start = columns.begin() + shared_pattern->inner_index()[i];
+            auto end = columns.begin() + shared_pattern->inner_index()[i + 1];
+            auto it = std::lower_bound(start, end, j);
+            return (it != end && *it == j) ? data[(it - columns.begin()) * batch + b] : T{0};
+        }
+
+        /**
+         * @brief Values of entry k of the pattern for all the items
+         */
+        std::span<T> entry(std::size_t k){ return std::span<T>(data).subspan(k * batch, batch);};
+        std::span<const T> entry(std::size_t k) const{ return std::span<const T>(data).subspan(k * batch, batch);};
+
+        /**
+         * @brief Batched matrix-vector product y_b = A_b x_b for all the items
+         *
+         * @param x Batched vector of cols() entries per item
+         * @param y Batched vector of rows() entries per item, receiving the products
+         * @param threads Number of threads
+         */
+        void multiply(std::span<const T> x, std::span<T> y, std::size_t threads = default_batch_threads()) const{
+            if (x.size() != cols() * batch || y.size() != rows() * batch) {
+                throw std::invalid_argument("Batched vector dimensions mismatch.");
+            }
+            parallel_batch(batch, threads, [&](std::size_t first, std::size_t last){
+                multiply_range(x.data() + first, batch, y.data() + first, batch, first, last);
+            });
+        }
+
+        /**
+         * @brief Batched matrix-vector product
+         *
+         * @param x Batched vector of cols() entries per item
+         * @return std::vector<T> Batched vector of rows() entries per item
+         */
+        std::vector<T> operator*(const std::vector<T>& x) const{
+            std::vector<T> y(rows() * batch);
+            multiply(x, y);
+            return y;
+        }
+
+        /**
+         * @brief Product of the items first to last (excluded) with vectors whose entries i start at x + i * x_stride,
+         * written at y + i * y_stride; used by the batched kernels on their range of items
+         */
+        void multiply_range(const T* x, std::size_t x_stride, T* y, std::size_t y_stride,
+                            std::size_t first, std::size_t last) const{
+            auto inner = shared_pattern->inner_index();
+            auto outer = shared_pattern->outer_index();
+            const std::size_t m = last - first;
+            for (std::size_t i = 0; i < rows(); ++i) {
+                T* yi = y + i * y_stride;
+                std::fill(yi, yi + m, T{0});
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    const T* values = data.data() + k * batch + first;
+                    const T* xj = x + outer[k] * x_stride;
+#pragma omp simd
+                    for (std::size_t l = 0; l < m; ++l) {
+                        yi[l] += values[l] * xj[l];
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Position of the entry (i, j) in the pattern; throws if it is not in the pattern
+         */
+        std::size_t position(std::size_t i, std::size_t j) const{
+            if (i >= rows() || j >= cols()) {
+                throw std::out_of_range("Index out of boundary");
+            }
+            auto columns = shared_pattern->outer_index();
+            auto start = columns.begin() + shared_pattern->inner_index()[i];
+            auto end = columns.begin() + shared_pattern->inner_index()[i + 1];
+            auto it = std::lower_bound(start, end, j);
+            if (it == end || *it != j) {
+                throw std::out_of_range("The element is not in the pattern of the batch.");
+            }
+            return it - columns.begin();
+        }
+
+        /**
+         * @brief Utility: the common sparsity pattern
+         */
+        const std::shared_ptr<const Pattern>& pattern() const{ return shared_pattern;};
+
+        /**
+         * @brief Utility: all the values, entry by entry
+         */
+        std::span<const T> values() const{ return data;};
+
+        std::size_t size() const{ return batch;};
+        std::size_t rows() const{ return shared_pattern->rows();};
+        std::size_t cols() const{ return shared_pattern->cols();};
+        std::size_t nonzeros() const{ return shared_pattern->nonzeros();};
+
+    private:
+        // Union of the patterns of the items
+        static std::shared_ptr<const Pattern> union_pattern(const std::vector<Matrix<T, StorageOrder::RowOrdering>>& items){
+            const std::size_t n = items[0].rows();
+            std::pmr::vector<std::size_t> inner, outer;
+            inner.reserve(n + 1);
+            inner.push_back(0);
+            std::vector<std::size_t> row;
+            for (std::size_t i = 0; i < n; ++i) {
+                row.clear();
+                for (const auto& item : items) {
+                    auto columns = item.outer_index().subspan(item.inner_index()[i], item.inner_index()[i + 1] - item.inner_index()[i]);
+                    row.insert(row.end(), columns.begin(), columns.end());
+                }
+                std::sort(row.begin(), row.end());
+                row.erase(std::unique(row.begin(), row.end()), row.end());
+                outer.insert(outer.end(), row.begin(), row.end());
+                inner.push_back(outer.size());
+            }
+            return std::make_shared<const Pattern>(n, items[0].cols(), std::move(inner), std::move(outer));
+        }
+
+        std::shared_ptr<const Pattern> shared_pattern; //!< pattern of all the items
+        std::size_t batch; //!< number of items
+        std::vector<T> data; //!< values, entry by entry: value of entry k of item b at k * batch + b
+    };
+
+    /**
+     * @brief Sparse LU factorization without pivoting of all the items of a BatchedMatrix of square matrices.
+     *
+     * The symbolic phase runs once on the common pattern: it computes the fill-in and records the elimination
+     * as a list of operations on positions of the factor. The numeric phase (factorize) replays the list and
+     * applies each operation to all the items with a vectorized loop, so that refactorizing a batch with new
+     * values (e.g. at every Newton step) costs no symbolic work. Without pivoting the items must be factorizable
+     * in their natural order, e.g. diagonally dominant.
+     *
+     * @tparam T The type of elements in the matrices
+     */
+    template<RealOrComplex T>
+    class BatchedLU {
+    public:
+        /**
+         * @brief Constructor: symbolic and numeric factorization
+         *
+         * @param A The batch of square matrices
+         * @param threads Number of threads
+         */
+        explicit BatchedLU(const BatchedMatrix<T>& A, std::size_t threads = default_batch_threads())
+            : n(A.rows()), batch(A.size()), threads(threads), pattern(A.pattern()){
+            if (A.rows() != A.cols()) {
+                throw std::invalid_argument("The matrices must be square.");
+            }
+            symbolic();
+            factorize(A);
+        }
+
+        /**
+         * @brief Numeric factorization of a batch with the same pattern and number of items as the one given
+         * to the constructor; throws std::runtime_error if an item has a zero pivot
+         */
+        void factorize(const BatchedMatrix<T>& A){
+            if (A.size() != batch || !(A.pattern() == pattern || *A.pattern() == *pattern)) {
+                throw std::invalid_argument("The batch must have the pattern used by the symbolic factorization.");
+            }
+            lu.assign(row_ptr.back() * batch, T{0});
+            parallel_batch(batch, threads, [&](std::size_t first, std::size_t last){
+                const std::size_t m = last - first;
+                for (std::size_t k = 0; k < scatter.size(); ++k) {
+                    std::copy_n(A.entry(k).data() + first, m, lu.data() + scatter[k] * batch + first);
+                }
+                for (const auto& step : eliminations) {
+                    T* l = lu.data() + step.lower * batch + first;
+                    const T* pivot = lu.data() + step.pivot * batch + first;
+#pragma omp simd
+                    for (std::size_t b = 0; b < m; ++b) {
+                        l[b] /= pivot[b];
+                    }
+                    for (std::size_t u = step.first_update; u < step.last_update; ++u) {
+                        T* target = lu.data() + updates[u].first * batch + first;
+                        const T* source = lu.data() + updates[u].second * batch + first;
+#pragma omp simd
+                        for (std::size_t b = 0; b < m; ++b) {
+                            target[b] -= l[b] * source[b];
+                        }
+                    }
+                }
+            });
+            for (std::size_t i = 0; i < n; ++i) {
+                auto pivots = std::span<const T>(lu).subspan(diagonal[i] * batch, batch);
+                if (std::any_of(pivots.begin(), pivots.end(), [](const T& value){ return value == T{0};})) {
+                    throw std::runtime_error("Zero pivot in the batched LU factorization.");
+                }
+            }
+        }
+
+        /**
+         * @brief Solves A_b x_b = b_b for all the items
+         *
+         * @param rhs Batched right hand side
+         * @param x Batched vector receiving the solutions
+         */
+        void solve(std::span<const T> rhs, std::span<T> x) const{
+            if (rhs.size() != n * batch || x.size() != n * batch) {
+                throw std::invalid_argument("Batched vector dimensions mismatch.");
+            }
+            std::copy(rhs.begin(), rhs.end(), x.begin());
+            parallel_batch(batch, threads, [&](std::size_t first, std::size_t last){
+                const std::size_t m = last - first;
+                // Forward substitution with the unit lower triangle
+                for (std::size_t i = 0; i < n; ++i) {
+                    T* xi = x.data() + i * batch + first;
+                    for (std::size_t k = row_ptr[i]; k < diagonal[i]; ++k) {
+                        const T* l = lu.data() + k * batch + first;
+                        const T* xj = x.data() + columns[k] * batch + first;
+#pragma omp simd
+                        for (std::size_t b = 0; b < m; ++b) {
+                            xi[b] -= l[b] * xj[b];
+                        }
+                    }
+                }
+                // Backward substitution with the upper triangle
+                for (std::size_t i = n; i-- > 0;) {
+                    T* xi = x.data() + i * batch + first;
+                    for (std::size_t k = diagonal[i] + 1; k < row_ptr[i + 1]; ++k) {
+                        const T* u = lu.data() + k * batch + first;
+                        const T* xj = x.data() + columns[k] * batch + first;
+#pragma omp simd
+                        for (std::size_t b = 0; b < m; ++b) {
+                            xi[b] -= u[b] * xj[b];
+                        }
+                    }
+                    const T* pivot = lu.data() + diagonal[i] * batch + first;
+#pragma omp simd
+                    for (std::size_t b = 0; b < m; ++b) {
+                        xi[b] /= pivot[b];
+                    }
+                }
+            });
+        }
+
+        /**
+         * @brief Solves A_b x_b = b_b for all the items
+         *
+         * @param rhs Batched right hand side
+         * @return std::vector<T> Batched solution
+         */
+        std::vector<T> solve(const std::vector<T>& rhs) const{
+            std::vector<T> x(rhs.size());
+            solve(rhs, x);
+            return x;
+        }
+
+        /**
+         * @brief Utility: number of entries of the factors of one item, fill-in included
+         */
+        std::size_t nonzeros() const{ return row_ptr.back();};
+
+    private:
+        // Division of the entry lower = (i, k) by the pivot (k, k), followed by the updates (i, j) -= (i, k) * (k, j)
+        struct Elimination {
+            std::size_t lower;
+            std::size_t pivot;
+            std::size_t first_update;
+            std::size_t last_update;
+        };
+
+        // Fill-in by rows (row i receives the upper part of every row k < i it depends on) and elimination list
+        void symbolic(){
+            auto inner = pattern->inner_index();
+            auto outer = pattern->outer_index();
+            row_ptr.assign(1, 0);
+            for (std::size_t i = 0; i < n; ++i) {
+                std::set<std::size_t> row(outer.begin() + inner[i], outer.begin() + inner[i + 1]);
+                row.insert(i);
+                for (auto it = row.begin(); *it < i; ++it) {
+                    row.insert(columns.begin() + diagonal[*it] + 1, columns.begin() + row_ptr[*it + 1]);
+                }
+                columns.insert(columns.end(), row.begin(), row.end());
+                row_ptr.push_back(columns.size());
+                diagonal.push_back(std::lower_bound(columns.begin() + row_ptr[i], columns.end(), i) - columns.begin());
+
+                for (std::size_t k = row_ptr[i]; k < diagonal[i]; ++k) {
+                    const std::size_t pivot_row = columns[k];
+                    Elimination step{k, diagonal[pivot_row], updates.size(), 0};
+                    for (std::size_t u = diagonal[pivot_row] + 1; u < row_ptr[pivot_row + 1]; ++u) {
+                        auto target = std::lower_bound(columns.begin() + k + 1, columns.begin() + row_ptr[i + 1], columns[u]);
+                        updates.emplace_back(target - columns.begin(), u);
+                    }
+                    step.last_update = updates.size();
+                    eliminations.push_back(step);
+                }
+            }
+            scatter.resize(pattern->nonzeros());
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    scatter[k] = std::lower_bound(columns.begin() + row_ptr[i], columns.begin() + row_ptr[i + 1], outer[k]) - columns.begin();
+                }
+            }
+        }
+
+        std::size_t n; //!< size of the matrices
+        std::size_t batch; //!< number of items
+        std::size_t threads; //!< number of threads
+        std::shared_ptr<const SparsityPattern<StorageOrder::RowOrdering>> pattern; //!< pattern of the matrices
+        std::vector<std::size_t> row_ptr; //!< first entry of each row of the factors
+        std::vector<std::size_t> columns; //!< column of each entry of the factors
+        std::vector<std::size_t> diagonal; //!< position of the diagonal entry of each row
+        std::vector<std::size_t> scatter; //!< position in the factors of each entry of the pattern
+        std::vector<Elimination> eliminations; //!< elimination steps, in order
+        std::vector<std::pair<std::size_t, std::size_t>> updates; //!< (target, source) positions of the updates
+        std::vector<T> lu; //!< values of the factors, entry by entry
+    };
+
+    /**
+     * @brief BiCGSTAB on all the items of a batch of square matrices at once.
+     *
+     * Each item has its own scalars and convergence test; an item stops updating once converged (or on breakdown)
+     * while the others go on. The items are split in tiles among threads, the whole iteration running on one tile
+     * at a time so that its vectors stay in cache.
+     *
+     * @param A The batch of matrices
+     * @param rhs Batched right hand side
+     * @param x Batched initial guess on input, solutions on output
+     * @param tol Tolerance on the relative residual of each item
+     * @param max_iter Maximum number of iterations
+     * @param threads Number of threads
+     * @return std::vector<SolverResult> Convergence information of each item
+     */
+    template<RealOrComplex T>
+    std::vector<SolverResult> bicgstab_batched(const BatchedMatrix<T>& A, std::span<const T> rhs, std::span<T> x,
+                                               double tol = 1e-10, std::size_t max_iter = 1000,
+                                               std::size_t threads = default_batch_threads()){
+        const std::size_t n = A.rows();
+        const std::size_t batch = A.size();
+        if (A.rows() != A.cols() || rhs.size() != n * batch || x.size() != n * batch) {
+            throw std::invalid_argument("Batched vector dimensions mismatch.");
+        }
+        std::vector<SolverResult> results(batch);
+        parallel_batch(batch, threads, [&](std::size_t first, std::size_t last){
+            const std::size_t m = last - first;
+            // Work vectors of the range, entry i of item first + l at i * m + l
+            std::vector<T> r(n * m), r_hat(n * m), p(n * m, T{0}), v(n * m, T{0}), s(n * m), t(n * m);
+            std::vector<T> rho(m, T{1}), alpha(m, T{1}), omega(m, T{1}), work(m);
+            std::vector<double> norm_b(m, 0.0), norm_r(m, 0.0);
+            std::vector<char> active(m, 1);
+            T* xr = x.data() + first;
+            const T* br = rhs.data() + first;
+
+            // Scalar products of the range, one per item
+            auto dot_range = [&](const std::vector<T>& a, const std::vector<T>& c, std::vector<T>& out){
+                std::fill(out.begin(), out.end(), T{0});
+                for (std::size_t i = 0; i < n; ++i) {
+#pragma omp simd
+                    for (std::size_t l = 0; l < m; ++l) {
+                        out[l] += conjugate(a[i * m + l]) * c[i * m + l];
+                    }
+                }
+            };
+            auto norms = [&](const std::vector<T>& a){
+                std::fill(norm_r.begin(), norm_r.end(), 0.0);
+                for (std::size_t i = 0; i < n; ++i) {
+                    for (std::size_t l = 0; l < m; ++l) {
+                        norm_r[l] += std::norm(a[i * m + l]);
+                    }
+                }
+            };
+            // Convergence test: the converged items are frozen
+            auto check = [&](std::size_t iteration){
+                norms(r);
+                bool any = false;
+                for (std::size_t l = 0; l < m; ++l) {
+                    if (active[l]) {
+                        results[first + l].iterations = iteration;
+                        results[first + l].residual = std::sqrt(norm_r[l]) / norm_b[l];
+                        if (results[first + l].residual <= tol) {
+                            results[first + l].converged = true;
+                            active[l] = 0;
+                        }
+                    }
+                    any = any || active[l];
+                }
+                return any;
+            };
+
+            A.multiply_range(xr, batch, r.data(), m, first, last);
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t l = 0; l < m; ++l) {
+                    r[i * m + l] = br[i * batch + l] - r[i * m + l];
+                    norm_b[l] += std::norm(br[i * batch + l]);
+                }
+            }
+            for (auto& value : norm_b) {
+                value = value > 0 ? std::sqrt(value) : 1.0;
+            }
+            r_hat = r;
+
+            for (std::size_t iteration = 0; check(iteration) && iteration < max_iter; ++iteration) {
+                // beta = (rho_new / rho) (alpha / omega), p = r + beta (p - omega v)
+                dot_range(r_hat, r, work);
+                for (std::size_t l = 0; l < m; ++l) {
+                    if (active[l] && (work[l] == T{0} || omega[l] == T{0})) {
+                        active[l] = 0; // breakdown
+                    }
+                    const T beta = active[l] ? (work[l] / rho[l]) * (alpha[l] / omega[l]) : T{0};
+                    rho[l] = active[l] ? work[l] : rho[l];
+                    work[l] = beta;
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+#pragma omp simd
+                    for (std::size_t l = 0; l < m; ++l) {
+                        p[i * m + l] = r[i * m + l] + work[l] * (p[i * m + l] - omega[l] * v[i * m + l]);
+                    }
+                }
+                A.multiply_range(p.data(), m, v.data(), m, first, last);
+
+                // alpha = rho / (r_hat, v), s = r - alpha v
+                dot_range(r_hat, v, work);
+                for (std::size_t l = 0; l < m; ++l) {
+                    if (active[l] && work[l] == T{0}) {
+                        active[l] = 0;
+                    }
+                    alpha[l] = active[l] ? rho[l] / work[l] : T{0};
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+#pragma omp simd
+                    for (std::size_t l = 0; l < m; ++l) {
+                        s[i * m + l] = r[i * m + l] - alpha[l] * v[i * m + l];
+                    }
+                }
+                A.multiply_range(s.data(), m, t.data(), m, first, last);
+
+                // omega = (t, s) / (t, t), x += alpha p + omega s, r = s - omega t
+                dot_range(t, s, work);
+                dot_range(t, t, omega);
+                for (std::size_t l = 0; l < m; ++l) {
+                    omega[l] = (active[l] && omega[l] != T{0}) ? work[l] / omega[l] : T{0};
+                }
+                for (std::size_t i = 0; i < n; ++i) {
+#pragma omp simd
+                    for (std::size_t l = 0; l < m; ++l) {
+                        xr[i * batch + l] += alpha[l] * p[i * m + l] + omega[l] * s[i * m + l];
+                        r[i * m + l] = s[i * m + l] - omega[l] * t[i * m + l];
+                    }
+                }
+            }
+        });
+        return results;
+    }
+
+} // namespace algebra
+
+#endif // BATCHED_MATRIX_HPP
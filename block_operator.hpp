@@ -0,0 +1,368 @@
+/**
+ * @file block_operator.hpp
+ * @brief Contains BlockOperator, an operator made of blocks referencing existing compressed matrices, and
+ * BlockDiagonalPreconditioner.
+ *
+ * Saddle-point and multiphysics systems such as
+ *
+ *     [ A  B^T ] [u]   [f]
+ *     [ B  0   ] [p] = [g]
+ *
+ * are applied block by block with the kernel of each matrix, without assembling a monolithic Matrix.
+ * Both types are LinearOperators and can be passed to the solvers of iterative_solvers.hpp.
+ */
+
+#ifndef BLOCK_OPERATOR_HPP
+#define BLOCK_OPERATOR_HPP
+
+#include "matrix_view.hpp"
+#include <functional>
+#include <thread>
+
+namespace algebra {
+
+    /**
+     * @brief Operator partitioned in blocks; each non empty block references a compressed matrix (possibly
+     * transposed and scaled), which must outlive the operator. Empty blocks are zero.
+     *
+     * The product runs the block rows in parallel (each thread owns the part of the result of its block rows),
+     * and within a block row accumulates the products of the blocks with the kernel of each matrix. The block rows
+     * are split among the threads by number of non zeros, and a thread is started only for min_thread_nonzeros
+     * non zeros at least: a single block row, or a small operator, is multiplied on the calling thread.
+     *
+     * @tparam T The type of elements in the matrices
+     */
+    template<RealOrComplex T>
+    class BlockOperator {
+    public:
+        /**
+         * @brief Constructor: operator with all the blocks empty
+         *
+         * @param row_sizes Number of rows of each block row
+         * @param col_sizes Number of columns of each block column
+         * @param threads Maximum number of threads of the product (one block row and min_thread_nonzeros non zeros
+         * per thread at least)
+         */
+        BlockOperator(std::vector<std::size_t> row_sizes, std::vector<std::size_t> col_sizes,
+                      std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1))
+            : row_sizes(std::move(row_sizes)), col_sizes(std::move(col_sizes)), threads(threads){
+            row_offsets.assign(1, 0);
+            for (std::size_t size : this->row_sizes) {
+                row_offsets.push_back(row_offsets.back() + size);
+            }
+            col_offsets.assign(1, 0);
+            for (std::size_t size : this->col_sizes) {
+                col_offsets.push_back(col_offsets.back() + size);
+            }
+            blocks.resize(this->row_sizes.size());
+            row_nonzeros.assign(this->row_sizes.size(), 0);
+        }
+
+        /**
+         * @brief Builds a block diagonal operator from square compressed matrices
+         */
+        template<StorageOrder Order>
+        static BlockOperator diagonal(const std::vector<const Matrix<T, Order>*>& matrices){
+            std::vector<std::size_t> sizes;
+            for (const auto* matrix : matrices) {
+                sizes.push_back(matrix->rows());
+            }
+            BlockOperator op(sizes, sizes);
+            for (std::size_t i = 0; i < matrices.size(); ++i) {
+                op.set_block(i, i, *matrices[i]);
+            }
+            return op;
+        }
+
+        /**
+         * @brief Sets the block (I, J) to scale * matrix, or scale * matrix^T
+         *
+         * @param I Block row
+         * @param J Block column
+         * @param matrix Compressed matrix, referenced (not copied)
+         * @param scale Factor multiplying the block
+         * @param transposed If true the block is the transpose of the matrix
+         */
+        template<StorageOrder Order>
+        void set_block(std::size_t I, std::size_t J, const MatrixView<T, Order>& matrix, const T& scale = T{1},
+                       bool transposed = false){
+            if (I >= row_sizes.size() || J >= col_sizes.size()) {
+                throw std::out_of_range("Block index out of boundary");
+            }
+            const std::size_t rows = transposed ? matrix.cols() : matrix.rows();
+            const std::size_t cols = transposed ? matrix.rows() : matrix.cols();
+            if (rows != row_sizes[I] || cols != col_sizes[J]) {
+                throw std::invalid_argument("The matrix does not have the size of the block.");
+            }
+            // The arrays of a CSR matrix are the arrays of its transpose in CSC, and vice versa
+            const bool by_rows = (Order == StorageOrder::RowOrdering) != transposed;
+            auto& row = blocks[I];
+            std::erase_if(row, [J](const Block& block){ return block.column == J;});
+            row.push_back(Block{J, by_rows, scale, matrix.inner_index(), matrix.outer_index(), matrix.values()});
+            row_nonzeros[I] = 0;
+            for (const Block& block : row) {
+                row_nonzeros[I] += block.data.size();
+            }
+        }
+
+        /**
+         * @brief Sets the block (I, J) to scale * matrix, or scale * matrix^T, for a compressed Matrix
+         */
+        template<StorageOrder Order>
+        void set_block(std::size_t I, std::size_t J, const Matrix<T, Order>& matrix, const T& scale = T{1},
+                       bool transposed = false){
+            set_block(I, J, MatrixView<T, Order>(matrix), scale, transposed);
+        }
+
+        /**
+         * @brief Product y = Op x, with x and y given as spans of cols() and rows() entries (the LinearOperator interface)
+         */
+        void apply(std::span<const T> x, std::span<T> y) const{
+            if (x.size() != cols() || y.size() != rows()) {
+                throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+            }
+            auto block_rows = [&](std::size_t first, std::size_t last){
+                for (std::size_t I = first; I < last; ++I) {
+                    auto y_block = y.subspan(row_offsets[I], row_sizes[I]);
+                    std::fill(y_block.begin(), y_block.end(), T{0});
+                    for (const Block& block : blocks[I]) {
+                        multiply_block(block, x.subspan(col_offsets[block.column], col_sizes[block.column]), y_block);
+                    }
+                }
+            };
+            std::size_t total = 0;
+            for (std::size_t nonzeros : row_nonzeros) {
+                total += nonzeros;
+            }
+            const std::size_t nthreads = std::clamp<std::size_t>(threads, 1,
+                                                                 std::max<std::size_t>(std::min(blocks.size(), total / min_thread_nonzeros), 1));
+            if (nthreads == 1) {
+                block_rows(0, blocks.size());
+                return;
+            }
+            // Thread t starts at the first block row after t/nthreads of the non zeros
+            std::vector<std::size_t> first(nthreads + 1, blocks.size());
+            first[0] = 0;
+            std::size_t I = 0, preceding = 0;
+            for (std::size_t t = 1; t < nthreads; ++t) {
+                while (I < blocks.size() && preceding < total * t / nthreads) {
+                    preceding += row_nonzeros[I++];
+                }
+                first[t] = I;
+            }
+            std::vector<std::thread> workers;
+            for (std::size_t t = 1; t < nthreads; ++t) {
+                if (first[t] < first[t + 1]) {
+                    workers.emplace_back(block_rows, first[t], first[t + 1]);
+                }
+            }
+            block_rows(0, first[1]);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+
+        /**
+         * @brief Operator-vector product
+         */
+        std::vector<T> operator*(const std::vector<T>& x) const{
+            std::vector<T> y(rows());
+            apply(x, y);
+            return y;
+        }
+
+        /**
+         * @brief Utility: position of the first row of block row I (I == number of block rows gives rows())
+         */
+        std::size_t row_offset(std::size_t I) const{ return row_offsets.at(I);};
+
+        /**
+         * @brief Utility: position of the first column of block column J
+         */
+        std::size_t col_offset(std::size_t J) const{ return col_offsets.at(J);};
+
+        std::size_t rows() const{ return row_offsets.back();};
+        std::size_t cols() const{ return col_offsets.back();};
+        std::size_t block_rows() const{ return row_sizes.size();};
+        std::size_t block_cols() const{ return col_sizes.size();};
+
+        static constexpr std::size_t min_thread_nonzeros = 1 << 16; //!< non zeros per thread of the product at least, to pay for its start
+
+    private:
+        // A non empty block: compressed arrays seen by rows (CSR) or by columns (CSC)
+        struct Block {
+            std::size_t column;
+            bool by_rows;
+            T scale;
+            std::span<const std::size_t> inner;
+            std::span<const std::size_t> outer;
+            std::span<const T> data;
+        };
+
+        // Accumulates scale * block * x into y with the kernel of the block storage
+        static void multiply_block(const Block& block, std::span<const T> x, std::span<T> y){
+            if (block.scale == T{1}) {
+                if (block.by_rows) {
+                    compressed_multiply<T, StorageOrder::RowOrdering>(block.inner, block.outer, block.data, x, y);
+                } else {
+                    compressed_multiply<T, StorageOrder::ColumnOrdering>(block.inner, block.outer, block.data, x, y);
+                }
+                return;
+            }
+            auto value = [&block](std::size_t k){ return block.scale * block.data[k];};
+            if (block.by_rows) {
+                compressed_multiply_with<T, StorageOrder::RowOrdering>(block.inner, block.outer, value, x, y);
+            } else {
+                compressed_multiply_with<T, StorageOrder::ColumnOrdering>(block.inner, block.outer, value, x, y);
+            }
+        }
+
+        std::vector<std::size_t> row_sizes; //!< rows of each block row
+        std::vector<std::size_t> col_sizes; //!< columns of each block column
+        std::vector<std::size_t> row_offsets; //!< first row of each block row, plus the total
+        std::vector<std::size_t> col_offsets; //!< first column of each block column, plus the total
+        std::vector<std::vector<Block>> blocks; //!< non empty blocks of each block row
+        std::vector<std::size_t> row_nonzeros; //!< non zeros of each block row
+        std::size_t threads; //!< maximum number of threads of the product
+    };
+
+    /**
+     * @brief Block diagonal (block Jacobi) preconditioner: applies an approximate inverse to each block of the vector.
+     * The approximation of each block is a callable y = M_I r (e.g. the inverse diagonal of the block, an inner solve,
+     * the inverse of a Schur complement approximation).
+     *
+     * @tparam T The type of elements in the vectors
+     */
+    template<RealOrComplex T>
+    class BlockDiagonalPreconditioner {
+    public:
+        using BlockSolver = std::function<void(std::span<const T>, std::span<T>)>; //!< computes y = M_I r
+
+        /**
+         * @brief Constructor: all the blocks are the identity
+         *
+         * @param sizes Size of each block
+         */
+        explicit BlockDiagonalPreconditioner(std::vector<std::size_t> sizes) : sizes(std::move(sizes)){
+            offsets.assign(1, 0);
+            for (std::size_t size : this->sizes) {
+                offsets.push_back(offsets.back() + size);
+            }
+            solvers.resize(this->sizes.size());
+        }
+
+        /**
+         * @brief Constructor: point Jacobi on every diagonal block of a square block operator
+         *
+         * @param A Block operator whose diagonal blocks are referenced in matrices
+         * @param matrices Matrix of each diagonal block (nullptr for the blocks left to the identity)
+         */
+        template<StorageOrder Order>
+        BlockDiagonalPreconditioner(const BlockOperator<T>& A, const std::vector<const Matrix<T, Order>*>& matrices)
+            : BlockDiagonalPreconditioner(block_sizes(A)){
+            if (matrices.size() != sizes.size()) {
+                throw std::invalid_argument("One matrix per diagonal block is required.");
+            }
+            for (std::size_t I = 0; I < sizes.size(); ++I) {
+                if (matrices[I] != nullptr) {
+                    set_jacobi(I, *matrices[I]);
+                }
+            }
+        }
+
+        /**
+         * @brief Sets the approximate inverse of block I
+         */
+        void set_block(std::size_t I, BlockSolver solver){
+            solvers.at(I) = std::move(solver);
+        }
+
+        /**
+         * @brief Sets the approximate inverse of block I to a linear operator (copied; a Matrix copy is O(1)),
+         * e.g. an explicit approximate inverse or a matrix-free kernel
+         */
+        template<typename Op>
+            requires LinearOperator<Op, T>
+        void set_block(std::size_t I, const Op& op){
+            if (op.rows() != sizes.at(I) || op.cols() != sizes[I]) {
+                throw std::invalid_argument("The operator does not have the size of the block.");
+            }
+            solvers[I] = [op](std::span<const T> r, std::span<T> y){ op.apply(r, y);};
+        }
+
+        /**
+         * @brief Sets the approximate inverse of block I to the inverse of the diagonal of a matrix
+         */
+        template<StorageOrder Order>
+        void set_jacobi(std::size_t I, const Matrix<T, Order>& matrix){
+            if (matrix.rows() != sizes.at(I) || matrix.cols() != sizes[I]) {
+                throw std::invalid_argument("The matrix does not have the size of the block.");
+            }
+            std::vector<T> inverse(sizes[I]);
+            for (std::size_t i = 0; i < inverse.size(); ++i) {
+                const T d = matrix(i, i);
+                if (d == T{0}) {
+                    throw std::runtime_error("Zero diagonal element in the Jacobi preconditioner.");
+                }
+                inverse[i] = T{1} / d;
+            }
+            solvers[I] = [inverse = std::move(inverse)](std::span<const T> r, std::span<T> y){
+                for (std::size_t i = 0; i < r.size(); ++i) {
+                    y[i] = inverse[i] * r[i];
+                }
+            };
+        }
+
+        /**
+         * @brief Applies the preconditioner, y = M r (the LinearOperator interface)
+         */
+        void apply(std::span<const T> r, std::span<T> y) const{
+            if (r.size() != rows() || y.size() != rows()) {
+                throw std::invalid_argument("Preconditioner-vector dimensions mismatch.");
+            }
+            for (std::size_t I = 0; I < sizes.size(); ++I) {
+                auto r_block = r.subspan(offsets[I], sizes[I]);
+                auto y_block = y.subspan(offsets[I], sizes[I]);
+                if (solvers[I]) {
+                    solvers[I](r_block, y_block);
+                } else {
+                    std::copy(r_block.begin(), r_block.end(), y_block.begin());
+                }
+            }
+        }
+
+        /**
+         * @brief Applies the preconditioner to a vector
+         */
+        std::vector<T> operator*(const std::vector<T>& r) const{
+            std::vector<T> y(r.size());
+            apply(r, y);
+            return y;
+        }
+
+        std::size_t rows() const{ return offsets.back();};
+        std::size_t cols() const{ return offsets.back();};
+
+    private:
+        static std::vector<std::size_t> block_sizes(const BlockOperator<T>& A){
+            if (A.block_rows() != A.block_cols()) {
+                throw std::invalid_argument("The block operator must have square diagonal blocks.");
+            }
+            std::vector<std::size_t> sizes;
+            for (std::size_t I = 0; I < A.block_rows(); ++I) {
+                sizes.push_back(A.row_offset(I + 1) - A.row_offset(I));
+                if (sizes.back() != A.col_offset(I + 1) - A.col_offset(I)) {
+                    throw std::invalid_argument("The block operator must have square diagonal blocks.");
+                }
+            }
+            return sizes;
+        }
+
+        std::vector<std::size_t> sizes; //!< size of each block
+        std::vector<std::size_t> offsets; //!< first entry of each block, plus the total
+        std::vector<BlockSolver> solvers; //!< approximate inverse of each block (empty: identity)
+    };
+
+} // namespace algebra
+
+#endif // BLOCK_OPERATOR_HPP
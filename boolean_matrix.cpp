@@ -0,0 +1,200 @@
+/**
+ * @file boolean_matrix.cpp
+ * @brief Contains the implementation of the BooleanMatrix member functions
+ */
+
+#include "boolean_matrix.hpp"
+#include <algorithm>
+#include <limits>
+
+
+namespace algebra {
+
+    // Constructor from the CSR arrays: the entries of each row are grouped by blocks of 64 columns,
+    // crowded blocks become bitmaps and the others stay as column indices. The column index is the transpose,
+    // stored in the same way
+    BooleanMatrix::BooleanMatrix(std::size_t rows, std::size_t cols, std::span<const std::size_t> row_ptr,
+                                 std::span<const std::size_t> columns, std::size_t min_block_bits, bool index_columns)
+        : numrows(rows), numcols(cols){
+        if (index_columns && rows > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("Too many rows for 32 bit indices.");
+        }
+        if (cols > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("Too many columns for 32 bit indices.");
+        }
+        if (row_ptr.size() != rows + 1 || row_ptr.back() - row_ptr.front() != columns.size()) {
+            throw std::invalid_argument("Inconsistent sizes of the compressed vectors.");
+        }
+        this->row_ptr.reserve(rows + 1);
+        block_ptr.reserve(rows + 1);
+        this->row_ptr.push_back(0);
+        block_ptr.push_back(0);
+        for (std::size_t i = 0; i < rows; ++i) {
+            const std::size_t end = row_ptr[i + 1] - row_ptr.front();
+            std::size_t k = row_ptr[i] - row_ptr.front();
+            while (k < end) {
+                // Entries of the block of columns containing columns[k]
+                const std::size_t block = columns[k] / 64;
+                std::size_t last = k;
+                while (last < end && columns[last] / 64 == block) {
+                    if (columns[last] >= cols) {
+                        throw std::out_of_range("Column index out of the matrix bounds.");
+                    }
+                    if (last > k && columns[last] <= columns[last - 1]) {
+                        throw std::invalid_argument("The columns must be sorted within each row.");
+                    }
+                    ++last;
+                }
+                if (last - k >= min_block_bits) {
+                    std::uint64_t bits = 0;
+                    for (; k < last; ++k) {
+                        bits |= std::uint64_t{1} << (columns[k] % 64);
+                    }
+                    block_index.push_back(static_cast<std::uint32_t>(block));
+                    block_bits.push_back(bits);
+                } else {
+                    for (; k < last; ++k) {
+                        this->columns.push_back(static_cast<std::uint32_t>(columns[k]));
+                    }
+                }
+            }
+            this->row_ptr.push_back(this->columns.size());
+            block_ptr.push_back(block_bits.size());
+        }
+        entries = columns.size();
+        if (index_columns) {
+            by_columns = std::make_shared<const BooleanMatrix>(transpose(min_block_bits));
+        }
+    }
+
+
+
+    // Transpose: counting sort of the entries by column. The rows are visited in increasing order,
+    // so the entries of every column come out sorted
+    BooleanMatrix BooleanMatrix::transpose(std::size_t min_block_bits) const{
+        std::vector<std::size_t> col_ptr(numcols + 1, 0);
+        auto for_each_entry = [this](std::size_t i, auto&& visit){
+            for (std::size_t b = block_ptr[i]; b < block_ptr[i + 1]; ++b) {
+                for (std::uint64_t word = block_bits[b]; word != 0; word &= word - 1) {
+                    visit(std::size_t{block_index[b]} * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+                }
+            }
+            for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                visit(std::size_t{columns[k]});
+            }
+        };
+        for (std::size_t i = 0; i < numrows; ++i) {
+            for_each_entry(i, [&col_ptr](std::size_t j){ ++col_ptr[j + 1];});
+        }
+        for (std::size_t j = 0; j < numcols; ++j) {
+            col_ptr[j + 1] += col_ptr[j];
+        }
+        std::vector<std::size_t> next(col_ptr.begin(), col_ptr.end() - 1);
+        std::vector<std::size_t> row_of(entries);
+        for (std::size_t i = 0; i < numrows; ++i) {
+            for_each_entry(i, [&next, &row_of, i](std::size_t j){ row_of[next[j]++] = i;});
+        }
+        return BooleanMatrix(numcols, numrows, col_ptr, row_of, min_block_bits, false);
+    }
+
+
+
+    // Reads the pattern with the reader of Matrix; the map is assembled in an arena
+    BooleanMatrix BooleanMatrix::read(const std::string& file_name, std::size_t min_block_bits){
+        AssemblyArena arena;
+        Matrix<double, StorageOrder::RowOrdering> matrix(0, 0, &arena);
+        matrix.read(file_name);
+        matrix.compress();
+        return BooleanMatrix(matrix, min_block_bits);
+    }
+
+
+
+    // Access to the entry (i, j): binary search in the bitmap blocks, then in the sparse columns
+    bool BooleanMatrix::operator()(std::size_t i, std::size_t j) const{
+        if (i >= numrows || j >= numcols) {
+            throw std::out_of_range("Index out of boundary");
+        }
+        auto blocks_begin = block_index.begin() + block_ptr[i];
+        auto blocks_end = block_index.begin() + block_ptr[i + 1];
+        auto block = std::lower_bound(blocks_begin, blocks_end, j / 64);
+        if (block != blocks_end && *block == j / 64) {
+            return (block_bits[block - block_index.begin()] >> (j % 64)) & 1;
+        }
+        return std::binary_search(columns.begin() + row_ptr[i], columns.begin() + row_ptr[i + 1], j);
+    }
+
+
+
+    // Boolean product: a row is true as soon as one of its blocks or sparse entries meets x
+    Bitset BooleanMatrix::multiply(const Bitset& x) const{
+        if (x.size() != (numcols + 63) / 64) {
+            throw std::invalid_argument("The vector must have one bit per column.");
+        }
+        Bitset y((numrows + 63) / 64, 0);
+        for (std::size_t i = 0; i < numrows; ++i) {
+            bool hit = false;
+            for (std::size_t b = block_ptr[i]; b < block_ptr[i + 1] && !hit; ++b) {
+                hit = (block_bits[b] & x[block_index[b]]) != 0;
+            }
+            for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1] && !hit; ++k) {
+                hit = test(x, columns[k]);
+            }
+            y[i / 64] |= std::uint64_t{hit} << (i % 64);
+        }
+        return y;
+    }
+
+
+
+    // Counting product: popcount of the AND of every bitmap block with x, plus the sparse entries
+    std::vector<std::uint32_t> BooleanMatrix::count(const Bitset& x) const{
+        if (x.size() != (numcols + 63) / 64) {
+            throw std::invalid_argument("The vector must have one bit per column.");
+        }
+        std::vector<std::uint32_t> y(numrows, 0);
+        for (std::size_t i = 0; i < numrows; ++i) {
+            std::uint32_t sum = 0;
+            for (std::size_t b = block_ptr[i]; b < block_ptr[i + 1]; ++b) {
+                sum += static_cast<std::uint32_t>(std::popcount(block_bits[b] & x[block_index[b]]));
+            }
+            for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                sum += static_cast<std::uint32_t>(test(x, columns[k]));
+            }
+            y[i] = sum;
+        }
+        return y;
+    }
+
+
+
+    // SpMSpV: the rows of the columns listed in x (rows of the transpose) are collected, sorted and merged
+    std::vector<std::size_t> BooleanMatrix::multiply_sparse(std::span<const std::size_t> x) const{
+        const BooleanMatrix& t = *by_columns;
+        std::vector<std::size_t> y;
+        for (std::size_t j : x) {
+            if (j >= numcols) {
+                throw std::out_of_range("Index out of the bitset bounds.");
+            }
+            for (std::size_t b = t.block_ptr[j]; b < t.block_ptr[j + 1]; ++b) {
+                for (std::uint64_t word = t.block_bits[b]; word != 0; word &= word - 1) {
+                    y.push_back(std::size_t{t.block_index[b]} * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+                }
+            }
+            y.insert(y.end(), t.columns.begin() + t.row_ptr[j], t.columns.begin() + t.row_ptr[j + 1]);
+        }
+        std::sort(y.begin(), y.end());
+        y.erase(std::unique(y.begin(), y.end()), y.end());
+        return y;
+    }
+
+
+
+    // Memory used by the arrays
+    std::size_t BooleanMatrix::storage_bytes() const{
+        return row_ptr.size() * sizeof(std::size_t) + columns.size() * sizeof(std::uint32_t)
+             + block_ptr.size() * sizeof(std::size_t) + block_index.size() * sizeof(std::uint32_t)
+             + block_bits.size() * sizeof(std::uint64_t) + (by_columns ? by_columns->storage_bytes() : 0);
+    }
+
+} // namespace algebra
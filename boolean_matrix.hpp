@@ -0,0 +1,182 @@
+/**
+ * @file boolean_matrix.hpp
+ * @brief Contains the definition of BooleanMatrix, a bit-packed sparse matrix without values (graph adjacency).
+ */
+
+#ifndef BOOLEAN_MATRIX_HPP
+#define BOOLEAN_MATRIX_HPP
+
+#include "sparse_matrix.hpp"
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+namespace algebra {
+
+    /**
+     * @brief Dense vector of bits, 64 entries per word (bit j%64 of word j/64); the unused bits of the last word are 0
+     */
+    using Bitset = std::vector<std::uint64_t>;
+
+    /**
+     * @brief Utility: builds a Bitset of length n with the given entries set
+     *
+     * @param indices Positions of the entries equal to 1
+     * @param n Length of the vector
+     */
+    inline Bitset make_bitset(std::span<const std::size_t> indices, std::size_t n){
+        Bitset bits((n + 63) / 64, 0);
+        for (std::size_t j : indices) {
+            if (j >= n) {
+                throw std::out_of_range("Index out of the bitset bounds.");
+            }
+            bits[j / 64] |= std::uint64_t{1} << (j % 64);
+        }
+        return bits;
+    }
+
+    /**
+     * @brief Utility: positions of the entries of a Bitset equal to 1, in increasing order
+     */
+    inline std::vector<std::size_t> bitset_indices(const Bitset& bits){
+        std::vector<std::size_t> indices;
+        for (std::size_t w = 0; w < bits.size(); ++w) {
+            for (std::uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                indices.push_back(w * 64 + static_cast<std::size_t>(std::countr_zero(word)));
+            }
+        }
+        return indices;
+    }
+
+    /**
+     * @brief Sparse boolean matrix stored by rows, without values.
+     *
+     * The columns of every row are split in blocks of 64. The blocks holding at least min_block_bits entries are
+     * stored as a 64 bit mask (bitmap block) with the index of the block; the remaining entries are stored as a
+     * CSR of 32 bit column indices. Dense sub-blocks (e.g. cliques, communities of a graph) then cost one bit per
+     * entry instead of an index. The products use AND and popcount on whole words.
+     * The same structure, built on the transpose, indexes the entries by columns for the SpMSpV.
+     */
+    class BooleanMatrix {
+    public:
+        /**
+         * @brief Constructor: builds the matrix from the CSR arrays of its pattern
+         *
+         * @param rows Number of rows
+         * @param cols Number of columns (less than 2^32)
+         * @param row_ptr Position of the first entry of each row in columns, plus the total (rows+1 entries)
+         * @param columns Column index of each entry, sorted within each row
+         * @param min_block_bits Minimum number of entries in a block of 64 columns to store it as a bitmap
+         */
+        BooleanMatrix(std::size_t rows, std::size_t cols, std::span<const std::size_t> row_ptr,
+                      std::span<const std::size_t> columns, std::size_t min_block_bits = 8)
+            : BooleanMatrix(rows, cols, row_ptr, columns, min_block_bits, true){}
+
+        /**
+         * @brief Constructor: the pattern of a compressed matrix; every stored element is an entry equal to true
+         *
+         * @param matrix Matrix in compressed format
+         * @param min_block_bits Minimum number of entries in a block of 64 columns to store it as a bitmap
+         */
+        template<RealOrComplex T>
+        explicit BooleanMatrix(const Matrix<T, StorageOrder::RowOrdering>& matrix, std::size_t min_block_bits = 8)
+            : BooleanMatrix(matrix.rows(), matrix.cols(), checked_inner(matrix), matrix.outer_index(), min_block_bits){}
+
+        /**
+         * @brief Reads the pattern of a matrix from a file in Matrix Market format (pattern, real or complex, general
+         * or symmetric); every entry of the file is an entry equal to true
+         *
+         * @param file_name Name of the file
+         * @param min_block_bits Minimum number of entries in a block of 64 columns to store it as a bitmap
+         */
+        static BooleanMatrix read(const std::string& file_name, std::size_t min_block_bits = 8);
+
+        /**
+         * @brief Const access to the entry (i, j)
+         */
+        bool operator()(std::size_t i, std::size_t j) const;
+
+        /**
+         * @brief Boolean matrix-vector product: y_i = OR_j (A_ij AND x_j)
+         *
+         * @param x Vector of cols() bits
+         * @return Bitset Vector of rows() bits
+         */
+        Bitset multiply(const Bitset& x) const;
+
+        /**
+         * @brief Counting product: y_i = number of j with A_ij AND x_j (e.g. common neighbours in a graph)
+         *
+         * @param x Vector of cols() bits
+         * @return std::vector<std::uint32_t> One count per row
+         */
+        std::vector<std::uint32_t> count(const Bitset& x) const;
+
+        /**
+         * @brief Sparse boolean matrix-sparse vector product (SpMSpV): rows having an entry in one of the given columns.
+         * Union of the rows of the given columns, read from the column index: the cost is proportional to the
+         * entries of these columns, not to the size of the matrix.
+         *
+         * @param x Columns of the entries of x equal to true
+         * @return std::vector<std::size_t> Rows of the entries of the result equal to true, in increasing order
+         */
+        std::vector<std::size_t> multiply_sparse(std::span<const std::size_t> x) const;
+
+        /**
+         * @brief Utility: returns the number of rows
+         */
+        std::size_t rows() const{ return numrows;};
+
+        /**
+         * @brief Utility: returns the number of columns
+         */
+        std::size_t cols() const{ return numcols;};
+
+        /**
+         * @brief Utility: returns the number of entries equal to true
+         */
+        std::size_t nonzeros() const{ return entries;};
+
+        /**
+         * @brief Utility: returns the number of bitmap blocks
+         */
+        std::size_t blocks() const{ return block_bits.size();};
+
+        /**
+         * @brief Utility: returns the memory used by the arrays of the matrix and of its column index, in bytes
+         */
+        std::size_t storage_bytes() const;
+
+    private:
+        // Constructor from the CSR arrays, building the column index or not
+        BooleanMatrix(std::size_t rows, std::size_t cols, std::span<const std::size_t> row_ptr,
+                      std::span<const std::size_t> columns, std::size_t min_block_bits, bool index_columns);
+
+        // Builds the transpose, without its own column index
+        BooleanMatrix transpose(std::size_t min_block_bits) const;
+
+        template<RealOrComplex T>
+        static std::span<const std::size_t> checked_inner(const Matrix<T, StorageOrder::RowOrdering>& matrix){
+            if (!matrix.is_compressed()) {
+                throw std::invalid_argument("The matrix must be compressed.");
+            }
+            return matrix.inner_index();
+        }
+
+        // Tests bit j of a bitset
+        static bool test(const Bitset& x, std::size_t j){ return (x[j / 64] >> (j % 64)) & 1;};
+
+        std::size_t numrows; //!< number of rows
+        std::size_t numcols; //!< number of columns
+        std::size_t entries = 0; //!< number of entries equal to true
+        std::vector<std::size_t> row_ptr; //!< first sparse entry of each row, plus the total
+        std::vector<std::uint32_t> columns; //!< column index of each sparse entry
+        std::vector<std::size_t> block_ptr; //!< first bitmap block of each row, plus the total
+        std::vector<std::uint32_t> block_index; //!< position of each bitmap block (column / 64)
+        std::vector<std::uint64_t> block_bits; //!< mask of each bitmap block
+        std::shared_ptr<const BooleanMatrix> by_columns; //!< transpose: the rows of each column (immutable, shared by copies)
+    };
+
+} // namespace algebra
+
+#endif // BOOLEAN_MATRIX_HPP
@@ -0,0 +1,620 @@
+/**
+ * @file distributed_matrix.hpp
+ * @brief Contains the definition of DistributedMatrix, a row-distributed sparse matrix over MPI ranks.
+ *
+ * This header requires MPI: compile the programs including it with mpicxx (see the target mpi of the Makefile).
+ */
+
+#ifndef DISTRIBUTED_MATRIX_HPP
+#define DISTRIBUTED_MATRIX_HPP
+
+#include "sparse_matrix.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <mpi.h>
+
+namespace algebra {
+
+    /**
+     * @brief MPI datatype corresponding to a C++ type
+     */
+    template<typename T>
+    MPI_Datatype mpi_datatype(){
+        if constexpr (std::is_same_v<T, double>) {
+            return MPI_DOUBLE;
+        } else if constexpr (std::is_same_v<T, float>) {
+            return MPI_FLOAT;
+        } else if constexpr (std::is_same_v<T, std::complex<double>>) {
+            return MPI_CXX_DOUBLE_COMPLEX;
+        } else if constexpr (std::is_same_v<T, std::complex<float>>) {
+            return MPI_CXX_FLOAT_COMPLEX;
+        } else if constexpr (std::is_same_v<T, std::size_t>) {
+            static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "std::size_t must be 64 bits wide");
+            return MPI_UINT64_T;
+        } else {
+            static_assert(std::is_same_v<T, double>, "No MPI datatype for this type");
+        }
+    }
+
+    /**
+     * @brief First index owned by a rank when n indices are split in contiguous blocks of (almost) equal size
+     *
+     * @param n Number of indices
+     * @param size Number of ranks
+     * @param rank Rank (rank == size gives n)
+     */
+    inline std::size_t partition_begin(std::size_t n, int size, int rank){
+        return n / size * rank + std::min<std::size_t>(rank, n % size);
+    }
+
+    /**
+     * @brief Sparse matrix whose rows are distributed in contiguous blocks over the ranks of a communicator.
+     *
+     * Rank r owns the rows [row_begin(), row_begin()+rows()) and the entries [col_begin(), col_begin()+cols())
+     * of the vectors it multiplies (the columns are split with the same rule as the rows).
+     * The local rows are split in two compressed (CSR) blocks: the local block, whose columns are owned by the
+     * rank, and the off-process block, whose columns (the ghosts) belong to other ranks and are renumbered
+     * 0..ghosts()-1. The halo exchange (who sends which entries of x to whom) is computed once in the constructor.
+     * The matrix-vector product posts the non-blocking halo exchange, multiplies the local block while the
+     * messages travel and then adds the off-process block.
+     *
+     * @tparam T The type of elements in the matrix
+     */
+    template<RealOrComplex T>
+    class DistributedMatrix {
+    public:
+        /**
+         * @brief Constructor: distributes a matrix available (compressed) on every rank; each rank keeps its rows
+         *
+         * @param comm Communicator
+         * @param global The whole matrix, in compressed format
+         */
+        DistributedMatrix(MPI_Comm comm, const Matrix<T, StorageOrder::RowOrdering>& global);
+
+        /**
+         * @brief Constructor: builds the matrix from the local rows of each rank
+         *
+         * @param comm Communicator
+         * @param global_rows Number of rows of the whole matrix
+         * @param global_cols Number of columns of the whole matrix
+         * @param row_ptr Inner index of the local rows (rows()+1 entries, starting from 0)
+         * @param columns Global column index of each local non zero element
+         * @param values Values of the local non zero elements
+         */
+        DistributedMatrix(MPI_Comm comm, std::size_t global_rows, std::size_t global_cols,
+                          std::vector<std::size_t>&& row_ptr, std::vector<std::size_t>&& columns, std::vector<T>&& values);
+
+        /**
+         * @brief Collective reading of a file in matrix market format: every rank reads a byte range of the file
+         * with MPI-IO, parses its entries and sends them to the ranks owning their rows (all-to-all exchange).
+         * Each rank then builds its blocks directly, the file is never read as a whole by a single rank.
+         * Supports the real, integer, complex and pattern fields and the general and symmetric structures.
+         *
+         * @param comm Communicator
+         * @param file_name Name of the file to read from
+         * @return DistributedMatrix The matrix distributed over the ranks of comm
+         */
+        static DistributedMatrix read(MPI_Comm comm, const std::string& file_name);
+
+        /**
+         * @brief Computes the local rows of y = A*x
+         *
+         * @param x Local entries of x (cols() entries)
+         * @param y Local entries of y (rows() entries), overwritten
+         */
+        void multiply(std::span<const T> x, std::span<T> y) const;
+
+        /**
+         * @brief Starts the halo exchange of x: posts the receives and the sends of the ghost entries
+         */
+        void begin_halo_exchange(std::span<const T> x) const;
+
+        /**
+         * @brief Waits for the halo exchange started by begin_halo_exchange
+         */
+        void end_halo_exchange() const;
+
+        /**
+         * @brief Utility: communicator of the matrix
+         */
+        MPI_Comm communicator() const{ return comm;};
+
+        /**
+         * @brief Utility: number of local rows
+         */
+        std::size_t rows() const{ return local.rows();};
+
+        /**
+         * @brief Utility: number of local columns (entries of x owned by the rank)
+         */
+        std::size_t cols() const{ return local.cols();};
+
+        /**
+         * @brief Utility: number of rows of the whole matrix
+         */
+        std::size_t global_rows() const{ return nrows;};
+
+        /**
+         * @brief Utility: number of columns of the whole matrix
+         */
+        std::size_t global_cols() const{ return ncols;};
+
+        /**
+         * @brief Utility: first global row owned by the rank
+         */
+        std::size_t row_begin() const{ return first_row;};
+
+        /**
+         * @brief Utility: first global column owned by the rank
+         */
+        std::size_t col_begin() const{ return first_col;};
+
+        /**
+         * @brief Utility: number of ghost entries of x received at every product
+         */
+        std::size_t ghosts() const{ return ghost_cols.size();};
+
+        /**
+         * @brief Utility: block of the local rows and local columns
+         */
+        const Matrix<T, StorageOrder::RowOrdering>& local_block() const{ return local;};
+
+        /**
+         * @brief Utility: block of the local rows and ghost columns
+         */
+        const Matrix<T, StorageOrder::RowOrdering>& off_process_block() const{ return off_process;};
+
+    private:
+        /**
+         * @brief Local rows with global column indices, as given to the constructor
+         */
+        struct LocalRows {
+            std::vector<std::size_t> row_ptr;
+            std::vector<std::size_t> columns;
+            std::vector<T> values;
+        };
+
+        DistributedMatrix(MPI_Comm comm, std::size_t global_rows, std::size_t global_cols, LocalRows&& rows);
+
+        // Splits the local rows in the two blocks and computes the halo pattern
+        void setup(LocalRows&& rows);
+
+        // Extracts the rows of this rank from a global matrix
+        static LocalRows extract_rows(MPI_Comm comm, const Matrix<T, StorageOrder::RowOrdering>& global);
+
+        MPI_Comm comm; //!< communicator
+        int rank = 0; //!< rank in the communicator
+        int size = 1; //!< size of the communicator
+        std::size_t nrows; //!< rows of the whole matrix
+        std::size_t ncols; //!< columns of the whole matrix
+        std::size_t first_row; //!< first global row owned
+        std::size_t first_col; //!< first global column owned
+
+        Matrix<T, StorageOrder::RowOrdering> local{0, 0}; //!< local columns
+        Matrix<T, StorageOrder::RowOrdering> off_process{0, 0}; //!< ghost columns
+        std::vector<std::size_t> ghost_cols; //!< global index of each ghost column, sorted
+
+        // Halo pattern: ghosts are received from recv_ranks[p] in ghost_buffer[recv_offsets[p], recv_offsets[p+1]),
+        // the entries x[send_indices[send_offsets[p] ...]] are sent to send_ranks[p]
+        std::vector<int> recv_ranks;
+        std::vector<std::size_t> recv_offsets;
+        std::vector<int> send_ranks;
+        std::vector<std::size_t> send_offsets;
+        std::vector<std::size_t> send_indices;
+
+        mutable std::vector<T> ghost_buffer; //!< received ghost entries of x
+        mutable std::vector<T> send_buffer; //!< packed entries of x to send
+        mutable std::vector<MPI_Request> requests; //!< pending halo messages
+    };
+
+
+
+    // Constructor from a global matrix
+    template<RealOrComplex T>
+    DistributedMatrix<T>::DistributedMatrix(MPI_Comm comm, const Matrix<T, StorageOrder::RowOrdering>& global)
+        : DistributedMatrix(comm, global.rows(), global.cols(), extract_rows(comm, global)){}
+
+
+
+    // Constructor from the local rows
+    template<RealOrComplex T>
+    DistributedMatrix<T>::DistributedMatrix(MPI_Comm comm, std::size_t global_rows, std::size_t global_cols,
+                                            std::vector<std::size_t>&& row_ptr, std::vector<std::size_t>&& columns,
+                                            std::vector<T>&& values)
+        : DistributedMatrix(comm, global_rows, global_cols, LocalRows{std::move(row_ptr), std::move(columns), std::move(values)}){}
+
+
+
+    template<RealOrComplex T>
+    DistributedMatrix<T>::DistributedMatrix(MPI_Comm comm, std::size_t global_rows, std::size_t global_cols, LocalRows&& rows)
+        : comm(comm), nrows(global_rows), ncols(global_cols){
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        first_row = partition_begin(nrows, size, rank);
+        first_col = partition_begin(ncols, size, rank);
+        if (rows.row_ptr.size() != partition_begin(nrows, size, rank + 1) - first_row + 1 ||
+            rows.row_ptr.back() != rows.columns.size() || rows.columns.size() != rows.values.size()) {
+            throw std::invalid_argument("DistributedMatrix: inconsistent local rows.");
+        }
+        setup(std::move(rows));
+    }
+
+
+
+    // Local rows of a global matrix, with the inner index shifted to start from 0
+    template<RealOrComplex T>
+    typename DistributedMatrix<T>::LocalRows DistributedMatrix<T>::extract_rows(MPI_Comm comm, const Matrix<T, StorageOrder::RowOrdering>& global){
+        if (!global.is_compressed()) {
+            throw std::invalid_argument("DistributedMatrix: the global matrix must be in compressed format.");
+        }
+        int r, s;
+        MPI_Comm_rank(comm, &r);
+        MPI_Comm_size(comm, &s);
+        auto inner = global.inner_index();
+        auto outer = global.outer_index();
+        auto data = global.values();
+        const std::size_t begin = partition_begin(global.rows(), s, r);
+        const std::size_t end = partition_begin(global.rows(), s, r + 1);
+
+        LocalRows rows;
+        rows.row_ptr.assign(inner.begin() + begin, inner.begin() + end + 1);
+        for (auto& k : rows.row_ptr) {
+            k -= inner[begin];
+        }
+        rows.columns.assign(outer.begin() + inner[begin], outer.begin() + inner[end]);
+        rows.values.assign(data.begin() + inner[begin], data.begin() + inner[end]);
+        return rows;
+    }
+
+
+
+    // Collective reading of a matrix market file
+    template<RealOrComplex T>
+    DistributedMatrix<T> DistributedMatrix<T>::read(MPI_Comm comm, const std::string& file_name){
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        // Rank 0 parses the header: banner, comments and sizes; the result is broadcast
+        // header = {rows, columns, non zeros, offset of the first entry, size of the file, symmetry, pattern, complex}
+        std::array<std::uint64_t, 8> header{};
+        constexpr std::uint64_t unknown_symmetry = std::numeric_limits<std::uint64_t>::max();
+        if (rank == 0) {
+            std::ifstream file(file_name);
+            std::string line;
+            if (file.is_open() && std::getline(file, line) && line.substr(0, 14) == "%%MatrixMarket") {
+                try {
+                    header[5] = static_cast<std::uint64_t>(matrix_market_symmetry(line));
+                } catch (const std::runtime_error&) {
+                    header[5] = unknown_symmetry; // reported by every rank after the broadcast
+                }
+                header[6] = line.find("pattern") != std::string::npos;
+                header[7] = line.find("complex") != std::string::npos;
+                while (std::getline(file, line) && (line.empty() || line[0] == '%')) {
+                    // Ignore comments
+                }
+                std::istringstream iss(line);
+                iss >> header[0] >> header[1] >> header[2];
+                header[3] = static_cast<std::uint64_t>(file.tellg());
+                file.seekg(0, std::ios::end);
+                header[4] = static_cast<std::uint64_t>(file.tellg());
+            }
+        }
+        MPI_Bcast(header.data(), 8, MPI_UINT64_T, 0, comm);
+        if (header[4] == 0) {
+            throw std::runtime_error("Error, cannot read the file in format Matrix Market: " + file_name);
+        }
+        if (header[5] == unknown_symmetry) {
+            throw std::runtime_error("Unknown symmetry in the Matrix Market banner of " + file_name);
+        }
+        const auto symmetry = static_cast<MatrixMarketSymmetry>(header[5]);
+        const bool pattern = header[6], complex_field = header[7];
+        if (complex_field && !Complex<T>) {
+            throw std::runtime_error("Complex matrix market file read into a real matrix: " + file_name);
+        }
+
+        MPI_File fh;
+        if (MPI_File_open(comm, file_name.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+            throw std::runtime_error("Error, cannot open the file: " + file_name);
+        }
+        // Reads [offset, offset+n) appending to buffer, in chunks that fit an int
+        const std::uint64_t chunk = std::uint64_t{1} << 30;
+        auto read_bytes = [&fh, chunk](std::string& buffer, std::uint64_t offset, std::uint64_t n){
+            const std::size_t old = buffer.size();
+            buffer.resize(old + n);
+            for (std::uint64_t done = 0; done < n; done += chunk) {
+                MPI_File_read_at(fh, offset + done, buffer.data() + old + done, static_cast<int>(std::min(chunk, n - done)),
+                                 MPI_CHAR, MPI_STATUS_IGNORE);
+            }
+        };
+
+        // Each rank owns the lines starting in its byte range; it reads one byte before the range,
+        // to know if a line starts exactly at its beginning, and after the range, to complete its last line
+        const std::uint64_t data_size = header[4] - header[3];
+        const std::uint64_t begin = header[3] + partition_begin(data_size, size, rank);
+        const std::uint64_t end = header[3] + partition_begin(data_size, size, rank + 1);
+        const std::uint64_t start = begin > header[3] ? begin - 1 : begin;
+        std::string buffer(end - start, '\0');
+        std::uint64_t chunks = (end - start + chunk - 1) / chunk;
+        MPI_Allreduce(MPI_IN_PLACE, &chunks, 1, MPI_UINT64_T, MPI_MAX, comm);
+        for (std::uint64_t c = 0; c < chunks; ++c) {
+            // Collective reads: every rank takes part in every call, possibly with an empty range
+            const std::uint64_t done = std::min(c * chunk, end - start);
+            MPI_File_read_at_all(fh, start + done, buffer.data() + done, static_cast<int>(std::min(chunk, end - start - done)),
+                                 MPI_CHAR, MPI_STATUS_IGNORE);
+        }
+        std::size_t pos = 0;
+        if (start < begin) {
+            pos = buffer.find('\n');
+            pos = (pos == std::string::npos) ? buffer.size() : pos + 1;
+        }
+        const std::size_t limit = end - start; // lines starting at or after limit belong to the next rank
+        if (pos < limit) {
+            // The last line starting in the range ends at the first newline at or after its last byte
+            for (std::uint64_t offset = end; offset < header[4] && buffer.find('\n', limit - 1) == std::string::npos; offset += 4096) {
+                read_bytes(buffer, offset, std::min<std::uint64_t>(4096, header[4] - offset));
+            }
+        }
+        MPI_File_close(&fh);
+
+        // Parse the entries and sort them by destination rank
+        std::vector<std::vector<std::size_t>> out_rows(size), out_cols(size);
+        std::vector<std::vector<T>> out_values(size);
+        auto push = [&](std::size_t i, std::size_t j, const T& value){
+            if (i >= header[0] || j >= header[1]) {
+                throw std::out_of_range("Entry out of the matrix bounds in " + file_name);
+            }
+            // Owner of row i: the largest rank whose first row is <= i
+            int owner = 0, hi = size - 1;
+            while (owner < hi) {
+                const int mid = (owner + hi + 1) / 2;
+                if (partition_begin(header[0], size, mid) <= i) {
+                    owner = mid;
+                } else {
+                    hi = mid - 1;
+                }
+            }
+            out_rows[owner].push_back(i);
+            out_cols[owner].push_back(j);
+            out_values[owner].push_back(value);
+        };
+        while (pos < limit && pos < buffer.size()) {
+            std::size_t eol = buffer.find('\n', pos);
+            if (eol == std::string::npos) {
+                eol = buffer.size();
+            }
+            const char* p = buffer.c_str() + pos;
+            char* next = nullptr;
+            if (buffer[pos] != '%') {
+                const std::size_t i = std::strtoull(p, &next, 10);
+                if (next != p) {
+                    p = next;
+                    const std::size_t j = std::strtoull(p, &next, 10);
+                    p = next;
+                    T value{1};
+                    if (!pattern) {
+                        const double re = std::strtod(p, &next);
+                        p = next;
+                        if constexpr (Complex<T>) {
+                            value = T(re, complex_field ? std::strtod(p, &next) : 0.0);
+                        } else {
+                            value = static_cast<T>(re);
+                        }
+                    }
+                    if (symmetry == MatrixMarketSymmetry::SkewSymmetric && i == j) {
+                        throw std::runtime_error("Diagonal entry in a skew-symmetric file: " + file_name);
+                    }
+                    push(i - 1, j - 1, value);
+                    if (symmetry != MatrixMarketSymmetry::General && i != j) {
+                        push(j - 1, i - 1, matrix_market_mirror(symmetry, value));
+                    }
+                }
+            }
+            pos = eol + 1;
+        }
+        buffer.clear();
+        buffer.shrink_to_fit();
+
+        // All-to-all exchange of the entries
+        std::vector<int> send_counts(size), recv_counts(size), send_displs(size + 1, 0), recv_displs(size + 1, 0);
+        for (int p = 0; p < size; ++p) {
+            send_counts[p] = static_cast<int>(out_rows[p].size());
+        }
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        for (int p = 0; p < size; ++p) {
+            send_displs[p + 1] = send_displs[p] + send_counts[p];
+            recv_displs[p + 1] = recv_displs[p] + recv_counts[p];
+        }
+        auto exchange = [&]<typename U>(std::vector<std::vector<U>>& outgoing){
+            std::vector<U> packed;
+            packed.reserve(send_displs[size]);
+            for (auto& part : outgoing) {
+                packed.insert(packed.end(), part.begin(), part.end());
+                part = std::vector<U>{};
+            }
+            std::vector<U> incoming(recv_displs[size]);
+            MPI_Alltoallv(packed.data(), send_counts.data(), send_displs.data(), mpi_datatype<U>(),
+                          incoming.data(), recv_counts.data(), recv_displs.data(), mpi_datatype<U>(), comm);
+            return incoming;
+        };
+        std::vector<std::size_t> rows = exchange(out_rows);
+        std::vector<std::size_t> cols = exchange(out_cols);
+        std::vector<T> values = exchange(out_values);
+
+        // Build the local rows: counting sort by row (the columns are sorted by the constructor)
+        const std::size_t first = partition_begin(header[0], size, rank);
+        const std::size_t nlocal = partition_begin(header[0], size, rank + 1) - first;
+        LocalRows local;
+        local.row_ptr.assign(nlocal + 1, 0);
+        for (std::size_t i : rows) {
+            ++local.row_ptr[i - first + 1];
+        }
+        std::partial_sum(local.row_ptr.begin(), local.row_ptr.end(), local.row_ptr.begin());
+        local.columns.resize(rows.size());
+        local.values.resize(rows.size());
+        std::vector<std::size_t> next(local.row_ptr.begin(), local.row_ptr.end() - 1);
+        for (std::size_t k = 0; k < rows.size(); ++k) {
+            const std::size_t dest = next[rows[k] - first]++;
+            local.columns[dest] = cols[k];
+            local.values[dest] = values[k];
+        }
+        return DistributedMatrix(comm, header[0], header[1], std::move(local));
+    }
+
+
+
+    // Splits the local rows in local and off-process blocks and computes the halo pattern
+    template<RealOrComplex T>
+    void DistributedMatrix<T>::setup(LocalRows&& rows){
+        const auto& row_ptr = rows.row_ptr;
+        const auto& columns = rows.columns;
+        const auto& values = rows.values;
+        const std::size_t local_rows = row_ptr.size() - 1;
+        const std::size_t last_col = partition_begin(ncols, size, rank + 1);
+
+        // Ghost columns: global columns outside the owned range, sorted (hence grouped by owner)
+        for (std::size_t j : columns) {
+            if (j < first_col || j >= last_col) {
+                ghost_cols.push_back(j);
+            }
+        }
+        std::sort(ghost_cols.begin(), ghost_cols.end());
+        ghost_cols.erase(std::unique(ghost_cols.begin(), ghost_cols.end()), ghost_cols.end());
+
+        // Split the rows in the two blocks, renumbering the columns
+        std::pmr::vector<std::size_t> local_inner{0}, local_outer, off_inner{0}, off_outer;
+        std::pmr::vector<T> local_data, off_data;
+        local_inner.reserve(local_rows + 1);
+        off_inner.reserve(local_rows + 1);
+        for (std::size_t i = 0; i < local_rows; ++i) {
+            // Entries of a row sorted by column, so that both blocks have sorted outer indices
+            std::vector<std::pair<std::size_t, T>> row;
+            for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                row.emplace_back(columns[k], values[k]);
+            }
+            std::sort(row.begin(), row.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+            for (const auto& [j, value] : row) {
+                if (j >= first_col && j < last_col) {
+                    local_outer.push_back(j - first_col);
+                    local_data.push_back(value);
+                } else {
+                    off_outer.push_back(std::lower_bound(ghost_cols.begin(), ghost_cols.end(), j) - ghost_cols.begin());
+                    off_data.push_back(value);
+                }
+            }
+            local_inner.push_back(local_outer.size());
+            off_inner.push_back(off_outer.size());
+        }
+        local = Matrix<T, StorageOrder::RowOrdering>(local_rows, last_col - first_col, std::move(local_inner),
+                                                     std::move(local_outer), std::move(local_data));
+        off_process = Matrix<T, StorageOrder::RowOrdering>(local_rows, ghost_cols.size(), std::move(off_inner),
+                                                           std::move(off_outer), std::move(off_data));
+        rows = LocalRows{};
+
+        // Number of ghosts needed from each rank
+        std::vector<int> recv_counts(size, 0), send_counts(size, 0);
+        int owner = 0;
+        for (std::size_t j : ghost_cols) {
+            while (j >= partition_begin(ncols, size, owner + 1)) {
+                ++owner;
+            }
+            ++recv_counts[owner];
+        }
+        MPI_Alltoall(recv_counts.data(), 1, MPI_INT, send_counts.data(), 1, MPI_INT, comm);
+
+        // Tell every owner which of its entries we need
+        std::vector<int> recv_displs(size + 1, 0), send_displs(size + 1, 0);
+        for (int p = 0; p < size; ++p) {
+            recv_displs[p + 1] = recv_displs[p] + recv_counts[p];
+            send_displs[p + 1] = send_displs[p] + send_counts[p];
+        }
+        send_indices.resize(send_displs[size]);
+        MPI_Alltoallv(ghost_cols.data(), recv_counts.data(), recv_displs.data(), mpi_datatype<std::size_t>(),
+                      send_indices.data(), send_counts.data(), send_displs.data(), mpi_datatype<std::size_t>(), comm);
+        for (auto& j : send_indices) {
+            j -= first_col;
+        }
+
+        // Keep only the neighbours
+        recv_offsets.push_back(0);
+        send_offsets.push_back(0);
+        for (int p = 0; p < size; ++p) {
+            if (recv_counts[p] > 0) {
+                recv_ranks.push_back(p);
+                recv_offsets.push_back(recv_displs[p + 1]);
+            }
+            if (send_counts[p] > 0) {
+                send_ranks.push_back(p);
+                send_offsets.push_back(send_displs[p + 1]);
+            }
+        }
+        ghost_buffer.resize(ghost_cols.size());
+        send_buffer.resize(send_indices.size());
+        requests.reserve(recv_ranks.size() + send_ranks.size());
+    }
+
+
+
+    // Posts the receives of the ghosts and the sends of the entries needed by the neighbours
+    template<RealOrComplex T>
+    void DistributedMatrix<T>::begin_halo_exchange(std::span<const T> x) const{
+        requests.clear();
+        for (std::size_t p = 0; p < recv_ranks.size(); ++p) {
+            requests.emplace_back();
+            MPI_Irecv(ghost_buffer.data() + recv_offsets[p], static_cast<int>(recv_offsets[p + 1] - recv_offsets[p]),
+                      mpi_datatype<T>(), recv_ranks[p], 0, comm, &requests.back());
+        }
+        for (std::size_t k = 0; k < send_indices.size(); ++k) {
+            send_buffer[k] = x[send_indices[k]];
+        }
+        for (std::size_t p = 0; p < send_ranks.size(); ++p) {
+            requests.emplace_back();
+            MPI_Isend(send_buffer.data() + send_offsets[p], static_cast<int>(send_offsets[p + 1] - send_offsets[p]),
+                      mpi_datatype<T>(), send_ranks[p], 0, comm, &requests.back());
+        }
+    }
+
+
+
+    // Waits for the halo exchange
+    template<RealOrComplex T>
+    void DistributedMatrix<T>::end_halo_exchange() const{
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        requests.clear();
+    }
+
+
+
+    // Matrix-vector product: the local block is multiplied while the halo exchange is in progress
+    template<RealOrComplex T>
+    void DistributedMatrix<T>::multiply(std::span<const T> x, std::span<T> y) const{
+        if (x.size() != cols() || y.size() != rows()) {
+            throw std::invalid_argument("DistributedMatrix: vectors of the wrong local size.");
+        }
+        begin_halo_exchange(x);
+        std::fill(y.begin(), y.end(), T{0});
+        compressed_multiply<T, StorageOrder::RowOrdering>(local.inner_index(), local.outer_index(), local.values(), x, y);
+        end_halo_exchange();
+        compressed_multiply<T, StorageOrder::RowOrdering>(off_process.inner_index(), off_process.outer_index(),
+                                                          off_process.values(), ghost_buffer, y);
+    }
+
+
+    /**
+     * @brief Matrix-vector multiplication with a distributed matrix
+     *
+     * @param matrix DistributedMatrix object
+     * @param vec Local entries of the vector
+     * @return std::vector<T> Local entries of the result
+     */
+    template<RealOrComplex T>
+    std::vector<T> operator*(const DistributedMatrix<T>& matrix, const std::vector<T>& vec){
+        std::vector<T> result(matrix.rows());
+        matrix.multiply(vec, result);
+        return result;
+    }
+
+} // namespace algebra
+
+#endif // DISTRIBUTED_MATRIX_HPP
@@ -0,0 +1,278 @@
+/**
+ * @file distributed_solvers.hpp
+ * @brief Contains Krylov solvers (CG, GMRES) for DistributedMatrix, with reduced global synchronization.
+ *
+ * This header requires MPI: compile the programs including it with mpicxx (see the target mpi of the Makefile).
+ */
+
+#ifndef DISTRIBUTED_SOLVERS_HPP
+#define DISTRIBUTED_SOLVERS_HPP
+
+#include "distributed_matrix.hpp"
+#include "iterative_solvers.hpp"
+
+namespace algebra {
+
+    /**
+     * @brief Time (in seconds) spent by a distributed solver in each phase, on the calling rank
+     */
+    struct SolverTiming {
+        double spmv = 0; //!< matrix-vector products, halo exchange included
+        double reductions = 0; //!< waiting for the global reductions (what is left after the overlap)
+        double vector_updates = 0; //!< local vector operations (axpy, local dot products, Gram-Schmidt)
+        double total = 0; //!< whole solve
+    };
+
+    /**
+     * @brief Outcome of a distributed solver: convergence information and time breakdown
+     */
+    struct DistributedSolverResult : SolverResult {
+        SolverTiming timing; //!< time spent in each phase
+    };
+
+    /**
+     * @brief Prints the time breakdown of a distributed solve
+     */
+    inline std::ostream& operator<<(std::ostream& os, const SolverTiming& timing){
+        os << "total " << timing.total << " s (SpMV " << timing.spmv << " s, reductions " << timing.reductions
+           << " s, vector updates " << timing.vector_updates << " s)";
+        return os;
+    }
+
+    namespace detail {
+        // Accumulates the time elapsed since start into phase and restarts the clock
+        inline void lap(double& phase, double& start){
+            const double now = MPI_Wtime();
+            phase += now - start;
+            start = now;
+        }
+    }
+
+    /**
+     * @brief Pipelined Conjugate Gradient (Ghysels and Vanroose) for Hermitian positive definite distributed matrices.
+     *
+     * The two scalar products of an iteration are merged in a single non-blocking allreduce (MPI_Iallreduce),
+     * which runs while the matrix-vector product of the same iteration is computed: one global synchronization
+     * per iteration, hidden behind the SpMV, instead of two blocking ones in the classical CG.
+     *
+     * @param A Distributed matrix (square)
+     * @param b Local entries of the right hand side
+     * @param x Local entries of the initial guess on input, of the solution on output
+     * @param tol Tolerance on the relative residual
+     * @param max_iter Maximum number of iterations
+     * @return DistributedSolverResult Convergence information and time breakdown (the same on every rank but the timing)
+     */
+    template<RealOrComplex T>
+    DistributedSolverResult cg(const DistributedMatrix<T>& A, const std::vector<T>& b, std::vector<T>& x,
+                               double tol = 1e-10, std::size_t max_iter = 1000){
+        DistributedSolverResult result;
+        SolverTiming& timing = result.timing;
+        const double t_begin = MPI_Wtime();
+        double clock = t_begin;
+        MPI_Comm comm = A.communicator();
+        const std::size_t n = A.rows();
+        x.resize(n, T{0});
+
+        double norm_b = std::pow(norm2(b), 2);
+        MPI_Allreduce(MPI_IN_PLACE, &norm_b, 1, MPI_DOUBLE, MPI_SUM, comm);
+        norm_b = norm_b > 0 ? std::sqrt(norm_b) : 1.0;
+        detail::lap(timing.reductions, clock);
+
+        std::vector<T> r(n), w(n), q(n), z(n, T{0}), s(n, T{0}), p(n, T{0});
+        A.multiply(x, r);
+        for (std::size_t i = 0; i < n; ++i) {
+            r[i] = b[i] - r[i];
+        }
+        A.multiply(r, w);
+        detail::lap(timing.spmv, clock);
+
+        T gamma_old{1}, alpha_old{1};
+        std::array<T, 2> partial, global;
+        MPI_Request request;
+        while (true) {
+            // gamma = (r,r), delta = (r,w): one merged reduction, overlapped with q = A*w
+            partial = {dot(r, r), dot(r, w)};
+            detail::lap(timing.vector_updates, clock);
+            MPI_Iallreduce(partial.data(), global.data(), 2, mpi_datatype<T>(), MPI_SUM, comm, &request);
+            A.multiply(w, q);
+            detail::lap(timing.spmv, clock);
+            MPI_Wait(&request, MPI_STATUS_IGNORE);
+            detail::lap(timing.reductions, clock);
+
+            const T gamma = global[0];
+            const T delta = global[1];
+            result.residual = std::sqrt(std::abs(gamma)) / norm_b;
+            if (result.residual <= tol || result.iterations >= max_iter) {
+                break;
+            }
+            T beta{0}, alpha = gamma / delta;
+            if (result.iterations > 0) {
+                beta = gamma / gamma_old;
+                alpha = gamma / (delta - beta * gamma / alpha_old);
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                z[i] = q[i] + beta * z[i];
+                s[i] = w[i] + beta * s[i];
+                p[i] = r[i] + beta * p[i];
+                x[i] += alpha * p[i];
+                r[i] -= alpha * s[i];
+                w[i] -= alpha * z[i];
+            }
+            gamma_old = gamma;
+            alpha_old = alpha;
+            ++result.iterations;
+        }
+        detail::lap(timing.vector_updates, clock);
+        result.converged = result.residual <= tol;
+        timing.total = MPI_Wtime() - t_begin;
+        return result;
+    }
+
+    /**
+     * @brief Restarted GMRES for distributed matrices, with one global reduction per iteration.
+     *
+     * The Arnoldi process uses classical Gram-Schmidt: all the projections (V_j, w) and ||w||^2 are computed
+     * in a single allreduce, and the norm of the new basis vector follows from ||w - sum h_j V_j||^2 =
+     * ||w||^2 - sum |h_j|^2. When this difference shows cancellation (loss of orthogonality) a second
+     * Gram-Schmidt pass, with its own reduction, is performed. The small least squares problem is solved
+     * redundantly on every rank.
+     *
+     * @param A Distributed matrix (square)
+     * @param b Local entries of the right hand side
+     * @param x Local entries of the initial guess on input, of the solution on output
+     * @param tol Tolerance on the relative residual
+     * @param max_iter Maximum number of iterations (over all restarts)
+     * @param restart Dimension of the Krylov space before a restart
+     * @return DistributedSolverResult Convergence information and time breakdown (the same on every rank but the timing)
+     */
+    template<RealOrComplex T>
+    DistributedSolverResult gmres(const DistributedMatrix<T>& A, const std::vector<T>& b, std::vector<T>& x,
+                                  double tol = 1e-10, std::size_t max_iter = 1000, std::size_t restart = 30){
+        DistributedSolverResult result;
+        SolverTiming& timing = result.timing;
+        const double t_begin = MPI_Wtime();
+        double clock = t_begin;
+        MPI_Comm comm = A.communicator();
+        const std::size_t n = A.rows();
+        x.resize(n, T{0});
+
+        double norm_b = std::pow(norm2(b), 2);
+        MPI_Allreduce(MPI_IN_PLACE, &norm_b, 1, MPI_DOUBLE, MPI_SUM, comm);
+        norm_b = norm_b > 0 ? std::sqrt(norm_b) : 1.0;
+        detail::lap(timing.reductions, clock);
+
+        std::vector<std::vector<T>> V(restart + 1, std::vector<T>(n));
+        std::vector<std::vector<T>> H(restart + 1, std::vector<T>(restart, T{0}));
+        std::vector<T> cs(restart), sn(restart), g(restart + 1), projections(restart + 2);
+        std::vector<T> r(n);
+
+        // Projections of w on V_0..V_k and ||w||^2 in one reduction; returns ||w||^2
+        auto project = [&](std::vector<T>& w, std::size_t k){
+            for (std::size_t j = 0; j <= k; ++j) {
+                projections[j] = dot(V[j], w);
+            }
+            projections[k + 1] = dot(w, w);
+            detail::lap(timing.vector_updates, clock);
+            MPI_Allreduce(MPI_IN_PLACE, projections.data(), static_cast<int>(k + 2), mpi_datatype<T>(), MPI_SUM, comm);
+            detail::lap(timing.reductions, clock);
+            for (std::size_t j = 0; j <= k; ++j) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    w[i] -= projections[j] * V[j][i];
+                }
+            }
+            return std::abs(projections[k + 1]);
+        };
+
+        while (true) {
+            A.multiply(x, r);
+            detail::lap(timing.spmv, clock);
+            for (std::size_t i = 0; i < n; ++i) {
+                r[i] = b[i] - r[i];
+            }
+            double beta = std::pow(norm2(r), 2);
+            detail::lap(timing.vector_updates, clock);
+            MPI_Allreduce(MPI_IN_PLACE, &beta, 1, MPI_DOUBLE, MPI_SUM, comm);
+            detail::lap(timing.reductions, clock);
+            beta = std::sqrt(beta);
+            result.residual = beta / norm_b;
+            if (result.residual <= tol || result.iterations >= max_iter) {
+                break;
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                V[0][i] = r[i] / beta;
+            }
+            std::fill(g.begin(), g.end(), T{0});
+            g[0] = beta;
+
+            std::size_t k = 0;
+            while (k < restart && result.iterations < max_iter) {
+                A.multiply(V[k], V[k + 1]);
+                detail::lap(timing.spmv, clock);
+                std::vector<T>& w = V[k + 1];
+
+                // Classical Gram-Schmidt with a single reduction
+                const double norm_w2 = project(w, k);
+                double h2 = norm_w2;
+                for (std::size_t j = 0; j <= k; ++j) {
+                    H[j][k] = projections[j];
+                    h2 -= std::norm(projections[j]);
+                }
+                if (h2 <= 1e-2 * norm_w2) {
+                    // Cancellation: the Pythagorean norm is unreliable, orthogonalize again
+                    h2 = project(w, k);
+                    for (std::size_t j = 0; j <= k; ++j) {
+                        H[j][k] += projections[j];
+                        h2 -= std::norm(projections[j]);
+                    }
+                }
+                const double h_next = std::sqrt(std::max(h2, 0.0));
+                for (auto& value : w) {
+                    value /= (h_next > 0 ? h_next : 1.0);
+                }
+
+                // Givens rotations, as in the serial GMRES
+                for (std::size_t j = 0; j < k; ++j) {
+                    const T tmp = conjugate(cs[j]) * H[j][k] + conjugate(sn[j]) * H[j + 1][k];
+                    H[j + 1][k] = -sn[j] * H[j][k] + cs[j] * H[j + 1][k];
+                    H[j][k] = tmp;
+                }
+                const double denom = std::sqrt(std::norm(H[k][k]) + h_next * h_next);
+                cs[k] = H[k][k] / denom;
+                sn[k] = T{h_next} / denom;
+                H[k][k] = denom;
+                g[k + 1] = -sn[k] * g[k];
+                g[k] = conjugate(cs[k]) * g[k];
+                detail::lap(timing.vector_updates, clock);
+
+                ++k;
+                ++result.iterations;
+                result.residual = std::abs(g[k]) / norm_b;
+                if (result.residual <= tol || h_next == 0) {
+                    break;
+                }
+            }
+
+            // Solve the triangular system and update the solution
+            std::vector<T> y(k);
+            for (std::size_t j = k; j-- > 0;) {
+                y[j] = g[j];
+                for (std::size_t l = j + 1; l < k; ++l) {
+                    y[j] -= H[j][l] * y[l];
+                }
+                y[j] /= H[j][j];
+            }
+            for (std::size_t j = 0; j < k; ++j) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    x[i] += y[j] * V[j][i];
+                }
+            }
+            detail::lap(timing.vector_updates, clock);
+        }
+        result.converged = result.residual <= tol;
+        timing.total = MPI_Wtime() - t_begin;
+        return result;
+    }
+
+} // namespace algebra
+
+#endif // DISTRIBUTED_SOLVERS_HPP
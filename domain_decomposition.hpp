@@ -0,0 +1,463 @@
+/**
+ * @file domain_decomposition.hpp
+ * @brief Contains the ILU(0) preconditioner, a banded LU solver and the restricted additive Schwarz preconditioner,
+ * whose overlapping subdomains are factored and solved in parallel, one thread per subdomain: the thread, created
+ * with the preconditioner, factors its subdomain and then solves it at every application.
+ */
+
+#ifndef DOMAIN_DECOMPOSITION_HPP
+#define DOMAIN_DECOMPOSITION_HPP
+
+#include "matrix_view.hpp"
+#include <variant>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace algebra {
+
+    /**
+     * @brief Incomplete LU factorization without fill-in (ILU(0)) of a compressed matrix stored by rows:
+     * L and U have the pattern of the matrix. apply() solves L U z = r, so it can be passed as preconditioner
+     * to the solvers of iterative_solvers.hpp.
+     *
+     * @tparam T The type of elements in the matrix
+     */
+    template<RealOrComplex T>
+    class ILU0 {
+    public:
+        /**
+         * @brief Constructor: computes the factorization; throws std::runtime_error on a zero pivot
+         *
+         * @param matrix Square matrix in compressed format, with plain values
+         */
+        explicit ILU0(const MatrixView<T, StorageOrder::RowOrdering>& matrix)
+            : n(matrix.rows()), row_ptr(matrix.inner_index().begin(), matrix.inner_index().end()),
+              columns(matrix.outer_index().begin() + row_ptr.front(), matrix.outer_index().begin() + row_ptr.back()),
+              lu(matrix.values().begin() + row_ptr.front(), matrix.values().begin() + row_ptr.back()){
+            if (matrix.rows() != matrix.cols()) {
+                throw std::invalid_argument("The matrix must be square.");
+            }
+            const std::size_t offset = row_ptr.front();
+            for (auto& value : row_ptr) {
+                value -= offset;
+            }
+            factorize();
+        }
+
+        /**
+         * @brief Constructor from a compressed Matrix
+         */
+        explicit ILU0(const Matrix<T, StorageOrder::RowOrdering>& matrix) : ILU0(MatrixView<T, StorageOrder::RowOrdering>(matrix)){}
+
+        /**
+         * @brief Solves L U z = r (forward and backward substitution)
+         */
+        void apply(std::span<const T> r, std::span<T> z) const{
+            if (r.size() != n || z.size() != n) {
+                throw std::invalid_argument("Preconditioner-vector dimensions mismatch.");
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                T sum = r[i];
+                for (std::size_t k = row_ptr[i]; k < diagonal[i]; ++k) {
+                    sum -= lu[k] * z[columns[k]];
+                }
+                z[i] = sum;
+            }
+            for (std::size_t i = n; i-- > 0;) {
+                T sum = z[i];
+                for (std::size_t k = diagonal[i] + 1; k < row_ptr[i + 1]; ++k) {
+                    sum -= lu[k] * z[columns[k]];
+                }
+                z[i] = sum / lu[diagonal[i]];
+            }
+        }
+
+        std::size_t rows() const{ return n;};
+        std::size_t cols() const{ return n;};
+
+    private:
+        // IKJ elimination restricted to the pattern: position holds where each column of row i is stored
+        void factorize(){
+            constexpr std::size_t absent = std::numeric_limits<std::size_t>::max();
+            std::vector<std::size_t> position(n, absent);
+            diagonal.resize(n);
+            for (std::size_t i = 0; i < n; ++i) {
+                diagonal[i] = absent;
+                for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                    position[columns[k]] = k;
+                    if (columns[k] == i) {
+                        diagonal[i] = k;
+                    }
+                }
+                if (diagonal[i] == absent) {
+                    throw std::runtime_error("ILU(0): missing diagonal element.");
+                }
+                for (std::size_t k = row_ptr[i]; k < diagonal[i]; ++k) {
+                    const std::size_t pivot_row = columns[k];
+                    lu[k] /= lu[diagonal[pivot_row]];
+                    for (std::size_t u = diagonal[pivot_row] + 1; u < row_ptr[pivot_row + 1]; ++u) {
+                        if (position[columns[u]] != absent) {
+                            lu[position[columns[u]]] -= lu[k] * lu[u];
+                        }
+                    }
+                }
+                if (lu[diagonal[i]] == T{0}) {
+                    throw std::runtime_error("ILU(0): zero pivot.");
+                }
+                for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                    position[columns[k]] = absent;
+                }
+            }
+        }
+
+        std::size_t n; //!< size of the matrix
+        std::vector<std::size_t> row_ptr; //!< first entry of each row
+        std::vector<std::size_t> columns; //!< column of each entry
+        std::vector<std::size_t> diagonal; //!< position of the diagonal entry of each row
+        std::vector<T> lu; //!< values of L (unit diagonal, not stored) and U
+    };
+
+    /**
+     * @brief LU factorization without pivoting of a compressed matrix stored by rows, in band storage:
+     * the fill-in stays within the lower and upper bandwidths of the matrix, so it is an exact solver for the
+     * matrices with a small bandwidth (e.g. discretizations in natural ordering and their subdomains).
+     * apply() solves A z = r.
+     *
+     * @tparam T The type of elements in the matrix
+     */
+    template<RealOrComplex T>
+    class BandedLU {
+    public:
+        /**
+         * @brief Constructor: computes the factorization; throws std::runtime_error on a zero pivot
+         *
+         * @param matrix Square matrix in compressed format, with plain values
+         */
+        explicit BandedLU(const MatrixView<T, StorageOrder::RowOrdering>& matrix) : n(matrix.rows()), lower(0), upper(0){
+            if (matrix.rows() != matrix.cols()) {
+                throw std::invalid_argument("The matrix must be square.");
+            }
+            auto inner = matrix.inner_index();
+            auto outer = matrix.outer_index();
+            auto data = matrix.values();
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    lower = std::max(lower, i - std::min(i, outer[k]));
+                    upper = std::max(upper, outer[k] - std::min(i, outer[k]));
+                }
+            }
+            width = lower + upper + 1;
+            band.assign(n * width, T{0});
+            for (std::size_t i = 0; i < n; ++i) {
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    at(i, outer[k]) = data[k];
+                }
+            }
+            for (std::size_t k = 0; k < n; ++k) {
+                if (at(k, k) == T{0}) {
+                    throw std::runtime_error("Banded LU: zero pivot.");
+                }
+                const std::size_t last_row = std::min(n, k + lower + 1), last_col = std::min(n, k + upper + 1);
+                for (std::size_t i = k + 1; i < last_row; ++i) {
+                    const T l = (at(i, k) /= at(k, k));
+                    // Columns k + 1 ... last_col - 1 of rows i and k are contiguous in the band
+                    T* row_i = band.data() + i * width + lower + k + 1 - i;
+                    const T* row_k = band.data() + k * width + lower + 1;
+                    const std::size_t count = last_col - k - 1;
+#pragma omp simd
+                    for (std::size_t j = 0; j < count; ++j) {
+                        row_i[j] -= l * row_k[j];
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Constructor from a compressed Matrix
+         */
+        explicit BandedLU(const Matrix<T, StorageOrder::RowOrdering>& matrix) : BandedLU(MatrixView<T, StorageOrder::RowOrdering>(matrix)){}
+
+        /**
+         * @brief Solves A z = r (forward and backward substitution)
+         */
+        void apply(std::span<const T> r, std::span<T> z) const{
+            if (r.size() != n || z.size() != n) {
+                throw std::invalid_argument("Preconditioner-vector dimensions mismatch.");
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                T sum = r[i];
+                for (std::size_t j = i - std::min(i, lower); j < i; ++j) {
+                    sum -= at(i, j) * z[j];
+                }
+                z[i] = sum;
+            }
+            for (std::size_t i = n; i-- > 0;) {
+                T sum = z[i];
+                for (std::size_t j = i + 1; j < std::min(n, i + upper + 1); ++j) {
+                    sum -= at(i, j) * z[j];
+                }
+                z[i] = sum / at(i, i);
+            }
+        }
+
+        std::size_t rows() const{ return n;};
+        std::size_t cols() const{ return n;};
+
+        /**
+         * @brief Utility: number of stored entries of the factors, n (lower + upper + 1)
+         */
+        std::size_t nonzeros() const{ return band.size();};
+
+    private:
+        // Element (i, j) with i - lower <= j <= i + upper; row i of the band is shifted so that column j is at j + lower - i
+        T& at(std::size_t i, std::size_t j){ return band[i * width + lower + j - i];};
+        const T& at(std::size_t i, std::size_t j) const{ return band[i * width + lower + j - i];};
+
+        std::size_t n; //!< size of the matrix
+        std::size_t lower; //!< lower bandwidth
+        std::size_t upper; //!< upper bandwidth
+        std::size_t width; //!< lower + upper + 1
+        std::vector<T> band; //!< rows of the factors in band storage, L with unit diagonal (not stored)
+    };
+
+    /**
+     * @brief Factorization used for the subdomains of AdditiveSchwarz
+     */
+    enum class LocalSolver {
+        ILU0,   //!< incomplete factorization without fill-in
+        Direct  //!< BandedLU, exact local solves
+    };
+
+    /**
+     * @brief Restricted additive Schwarz (RAS) preconditioner on a compressed matrix stored by rows.
+     *
+     * The rows are split in contiguous subdomains, each extended by `overlap` layers of neighbours in the graph of
+     * the matrix. The local matrix of a subdomain (extracted with submatrix) is factored by the thread that owns
+     * it, and every application solves all the local problems in parallel: each subdomain restricts the residual
+     * to its extended rows, solves, and writes only the rows it owns (restricted combination, no write conflicts).
+     * With overlap 0 it is block Jacobi. The preconditioner is not symmetric: use it with gmres.
+     *
+     * @tparam T The type of elements in the matrix
+     */
+    template<RealOrComplex T>
+    class AdditiveSchwarz {
+    public:
+        /**
+         * @brief Constructor: partitions the matrix and factors the subdomains, one thread per subdomain. The thread
+         * of subdomain s factors it and then solves it at every apply() (subdomain 0 on the calling thread).
+         * Throws the exception of the first subdomain whose factorization failed (e.g. std::runtime_error on a
+         * zero pivot), after stopping the threads
+         *
+         * @param matrix Square matrix in compressed format, with plain values; it is not referenced afterwards
+         * @param subdomains Number of subdomains
+         * @param overlap Number of layers of neighbours added to every subdomain
+         * @param solver Factorization of the local matrices
+         */
+        AdditiveSchwarz(const Matrix<T, StorageOrder::RowOrdering>& matrix, std::size_t subdomains, std::size_t overlap = 1,
+                        LocalSolver solver = LocalSolver::ILU0)
+            : n(matrix.rows()), domains(std::clamp<std::size_t>(subdomains, 1, std::max<std::size_t>(matrix.rows(), 1))){
+            if (matrix.rows() != matrix.cols()) {
+                throw std::invalid_argument("The matrix must be square.");
+            }
+            const MatrixView<T, StorageOrder::RowOrdering> view(matrix);
+            // An exception must not leave a thread: it is kept and rethrown here once every set-up is over
+            std::vector<std::exception_ptr> errors(domains.size());
+            auto set_up = [&](std::size_t s){
+                try {
+                    setup(view, s, overlap, solver);
+                } catch (...) {
+                    errors[s] = std::current_exception();
+                }
+            };
+            // The threads of subdomains 1 ... subdomains()-1 live with the preconditioner: they set up their
+            // subdomain, report it, then wait for apply()
+            pending = domains.size() - 1;
+            try {
+                for (std::size_t s = 1; s < domains.size(); ++s) {
+                    pool.emplace_back([this, s, &set_up]{
+                        set_up(s);
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (--pending == 0) {
+                                done.notify_one();
+                            }
+                        }
+                        work(s);
+                    });
+                }
+            } catch (...) {
+                shutdown();
+                throw;
+            }
+            set_up(0);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait(lock, [this]{ return pending == 0;});
+            }
+            for (const auto& error : errors) {
+                if (error) {
+                    shutdown();
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+        AdditiveSchwarz(const AdditiveSchwarz&) = delete;
+        AdditiveSchwarz& operator=(const AdditiveSchwarz&) = delete;
+
+        ~AdditiveSchwarz(){ shutdown();};
+
+        /**
+         * @brief Applies the preconditioner, z = sum_s R_s^owned A_s^-1 R_s r, the subdomains in parallel on the
+         * threads of the preconditioner (subdomain 0 on the calling thread); not to be called concurrently
+         */
+        void apply(std::span<const T> r, std::span<T> z) const{
+            if (r.size() != n || z.size() != n) {
+                throw std::invalid_argument("Preconditioner-vector dimensions mismatch.");
+            }
+            if (!pool.empty()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                task_r = r;
+                task_z = z;
+                pending = pool.size();
+                ++generation;
+            }
+            start.notify_all();
+            solve_local(0, r, z);
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this]{ return pending == 0;});
+        }
+
+        std::size_t rows() const{ return n;};
+        std::size_t cols() const{ return n;};
+
+        /**
+         * @brief Utility: number of subdomains
+         */
+        std::size_t subdomains() const{ return domains.size();};
+
+        /**
+         * @brief Utility: number of rows of subdomain s, overlap included
+         */
+        std::size_t subdomain_size(std::size_t s) const{ return domains.at(s).rows.size();};
+
+    private:
+        struct Subdomain {
+            std::size_t first; //!< first owned row
+            std::size_t last; //!< row after the last owned one
+            std::size_t local_first; //!< position of the first owned row among rows
+            std::vector<std::size_t> rows; //!< owned rows and overlap, increasing
+            std::variant<std::monostate, ILU0<T>, BandedLU<T>> factors; //!< factorization of the local matrix
+            mutable std::vector<T> r_local; //!< restriction of r, reused by every application
+            mutable std::vector<T> z_local; //!< local solution, reused by every application
+        };
+
+        // Owned rows, overlap by breadth-first search on the graph of the matrix, extraction and factorization
+        void setup(const MatrixView<T, StorageOrder::RowOrdering>& view, std::size_t s, std::size_t overlap, LocalSolver solver){
+            Subdomain& domain = domains[s];
+            domain.first = n * s / domains.size();
+            domain.last = n * (s + 1) / domains.size();
+            std::vector<char> inside(n, 0);
+            std::vector<std::size_t> frontier;
+            for (std::size_t i = domain.first; i < domain.last; ++i) {
+                inside[i] = 1;
+                frontier.push_back(i);
+            }
+            domain.rows = frontier;
+            auto inner = view.inner_index();
+            auto outer = view.outer_index();
+            for (std::size_t level = 0; level < overlap; ++level) {
+                std::vector<std::size_t> next;
+                for (std::size_t i : frontier) {
+                    for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                        if (!inside[outer[k]]) {
+                            inside[outer[k]] = 1;
+                            next.push_back(outer[k]);
+                        }
+                    }
+                }
+                domain.rows.insert(domain.rows.end(), next.begin(), next.end());
+                frontier = std::move(next);
+            }
+            std::sort(domain.rows.begin(), domain.rows.end());
+            domain.local_first = std::lower_bound(domain.rows.begin(), domain.rows.end(), domain.first) - domain.rows.begin();
+            domain.r_local.resize(domain.rows.size());
+            domain.z_local.resize(domain.rows.size());
+
+            auto local = submatrix(view, domain.rows, domain.rows, 1);
+            if (solver == LocalSolver::ILU0) {
+                domain.factors.template emplace<ILU0<T>>(local);
+            } else {
+                domain.factors.template emplace<BandedLU<T>>(local);
+            }
+        }
+
+        // Local solve of subdomain s, written on its owned rows
+        void solve_local(std::size_t s, std::span<const T> r, std::span<T> z) const{
+            const Subdomain& domain = domains[s];
+            for (std::size_t l = 0; l < domain.rows.size(); ++l) {
+                domain.r_local[l] = r[domain.rows[l]];
+            }
+            if (const auto* ilu = std::get_if<ILU0<T>>(&domain.factors)) {
+                ilu->apply(domain.r_local, domain.z_local);
+            } else {
+                std::get<BandedLU<T>>(domain.factors).apply(domain.r_local, domain.z_local);
+            }
+            std::copy_n(domain.z_local.begin() + domain.local_first, domain.last - domain.first, z.begin() + domain.first);
+        }
+
+        // Stops and joins the threads
+        void shutdown(){
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            start.notify_all();
+            for (auto& thread : pool) {
+                thread.join();
+            }
+            pool.clear();
+        }
+
+        // Loop of the thread of subdomain s: waits for a new generation (an application) or for the destructor
+        void work(std::size_t s) const{
+            std::uint64_t seen = 0;
+            while (true) {
+                std::span<const T> r;
+                std::span<T> z;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    start.wait(lock, [this, seen]{ return stop || generation != seen;});
+                    if (stop) {
+                        return;
+                    }
+                    seen = generation;
+                    r = task_r;
+                    z = task_z;
+                }
+                solve_local(s, r, z);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    done.notify_one();
+                }
+            }
+        }
+
+        std::size_t n; //!< size of the matrix
+        std::vector<Subdomain> domains; //!< the subdomains
+
+        std::vector<std::thread> pool; //!< threads of the subdomains 1 ... subdomains()-1
+        mutable std::mutex mutex; //!< protects the members below
+        mutable std::condition_variable start; //!< signals a new application (or the destructor) to the threads
+        mutable std::condition_variable done; //!< signals the end of the local solves to apply()
+        mutable std::uint64_t generation = 0; //!< number of applications
+        mutable std::size_t pending = 0; //!< local solves of the current application still running
+        mutable std::span<const T> task_r; //!< r of the current application
+        mutable std::span<T> task_z; //!< z of the current application
+        bool stop = false; //!< set by the destructor
+    };
+
+} // namespace algebra
+
+#endif // DOMAIN_DECOMPOSITION_HPP
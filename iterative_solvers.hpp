@@ -0,0 +1,257 @@
+/**
+ * @file iterative_solvers.hpp
+ * @brief Contains Krylov solvers (CG, GMRES) for sparse linear systems.
+ */
+
+#ifndef ITERATIVE_SOLVERS_HPP
+#define ITERATIVE_SOLVERS_HPP
+
+#include "sparse_matrix.hpp"
+
+namespace algebra {
+
+    /**
+     * @brief Outcome of an iterative solver
+     */
+    struct SolverResult {
+        bool converged = false; //!< true if the tolerance was reached
+        std::size_t iterations = 0; //!< number of iterations performed
+        double residual = 0; //!< final relative residual ||b-Ax||/||b||
+    };
+
+    /**
+     * @brief Complex conjugate for complex types, identity for real types
+     */
+    template<RealOrComplex T>
+    T conjugate(const T& value){
+        if constexpr (Complex<T>) {
+            return std::conj(value);
+        } else {
+            return value;
+        }
+    }
+
+    /**
+     * @brief Hermitian scalar product (x,y) = sum conj(x_i) y_i
+     */
+    template<RealOrComplex T>
+    T dot(const std::vector<T>& x, const std::vector<T>& y){
+        T sum{0};
+        for (std::size_t i = 0; i < x.size(); ++i) {
+            sum += conjugate(x[i]) * y[i];
+        }
+        return sum;
+    }
+
+    /**
+     * @brief Euclidean norm of a vector
+     */
+    template<RealOrComplex T>
+    double norm2(const std::vector<T>& x){
+        double sum{0};
+        for (const auto& value : x) {
+            sum += std::norm(value);
+        }
+        return std::sqrt(sum);
+    }
+
+    /**
+     * @brief Preconditioner doing nothing, the default of the solvers (it is skipped at compile time)
+     */
+    struct IdentityPreconditioner {};
+
+    /**
+     * @brief Concept to check if a type can precondition a solver on vectors of T: the identity or a LinearOperator
+     * applying an approximation of A^-1
+     */
+    template<typename M, typename T>
+    concept PreconditionerFor = std::same_as<M, IdentityPreconditioner> || LinearOperator<M, T>;
+
+    /**
+     * @brief Applies a preconditioner, z = M r
+     */
+    template<RealOrComplex T, typename Preconditioner>
+        requires PreconditionerFor<Preconditioner, T>
+    void precondition(const Preconditioner& M, const std::vector<T>& r, std::vector<T>& z){
+        if constexpr (std::same_as<Preconditioner, IdentityPreconditioner>) {
+            std::copy(r.begin(), r.end(), z.begin());
+        } else {
+            M.apply(r, z);
+        }
+    }
+
+    /**
+     * @brief Conjugate Gradient method, for Hermitian positive definite operators
+     *
+     * @tparam Operator Type of the operator: any LinearOperator (Matrix, MatrixView, BlockOperator, matrix-free kernel)
+     * @tparam Preconditioner Type of the preconditioner: a LinearOperator applying an approximation of A^-1
+     * (e.g. a BlockDiagonalPreconditioner), Hermitian positive definite
+     * @param A Operator of the system
+     * @param b Right hand side
+     * @param x Initial guess on input, solution on output
+     * @param tol Tolerance on the relative residual
+     * @param max_iter Maximum number of iterations
+     * @param M Preconditioner
+     * @return SolverResult Convergence information
+     */
+    template<typename Operator, RealOrComplex T, typename Preconditioner = IdentityPreconditioner>
+        requires LinearOperator<Operator, T> && PreconditionerFor<Preconditioner, T>
+    SolverResult cg(const Operator& A, const std::vector<T>& b, std::vector<T>& x,
+                    double tol = 1e-10, std::size_t max_iter = 1000, const Preconditioner& M = {}){
+        SolverResult result;
+        const std::size_t n = A.rows();
+        x.resize(n, T{0});
+        const double norm_b = norm2(b) > 0 ? norm2(b) : 1.0;
+
+        // The work vectors are allocated once, the operator writes into them
+        std::vector<T> r(n), z(n), q(n);
+        A.apply(x, r);
+        for (std::size_t i = 0; i < n; ++i) {
+            r[i] = b[i] - r[i];
+        }
+        precondition(M, r, z);
+        std::vector<T> p = z;
+        T rho = dot(r, z);
+        result.residual = norm2(r) / norm_b;
+
+        while (result.residual > tol && result.iterations < max_iter) {
+            A.apply(p, q);
+            const T alpha = rho / dot(p, q);
+            for (std::size_t i = 0; i < n; ++i) {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+            }
+            precondition(M, r, z);
+            const T rho_new = dot(r, z);
+            const T beta = rho_new / rho;
+            rho = rho_new;
+            for (std::size_t i = 0; i < p.size(); ++i) {
+                p[i] = z[i] + beta * p[i];
+            }
+            ++result.iterations;
+            result.residual = norm2(r) / norm_b;
+        }
+        result.converged = result.residual <= tol;
+        return result;
+    }
+
+    /**
+     * @brief Restarted GMRES method, for general operators, with right preconditioning
+     *
+     * @tparam Operator Type of the operator: any LinearOperator (Matrix, MatrixView, BlockOperator, matrix-free kernel)
+     * @tparam Preconditioner Type of the preconditioner: a LinearOperator applying an approximation of A^-1
+     * @param A Operator of the system
+     * @param b Right hand side
+     * @param x Initial guess on input, solution on output
+     * @param tol Tolerance on the relative residual
+     * @param max_iter Maximum number of iterations (over all restarts)
+     * @param restart Dimension of the Krylov space before a restart
+     * @param M Preconditioner
+     * @return SolverResult Convergence information
+     */
+    template<typename Operator, RealOrComplex T, typename Preconditioner = IdentityPreconditioner>
+        requires LinearOperator<Operator, T> && PreconditionerFor<Preconditioner, T>
+    SolverResult gmres(const Operator& A, const std::vector<T>& b, std::vector<T>& x,
+                       double tol = 1e-10, std::size_t max_iter = 1000, std::size_t restart = 30,
+                       const Preconditioner& M = {}){
+        constexpr bool preconditioned = !std::is_same_v<Preconditioner, IdentityPreconditioner>;
+        SolverResult result;
+        x.resize(A.rows(), T{0});
+        const std::size_t n = A.rows();
+        const double norm_b = norm2(b) > 0 ? norm2(b) : 1.0;
+
+        std::vector<std::vector<T>> V(restart + 1, std::vector<T>(n));
+        std::vector<std::vector<T>> H(restart + 1, std::vector<T>(restart, T{0})); // Hessenberg matrix
+        std::vector<T> cs(restart), sn(restart), g(restart + 1);
+        std::vector<T> r(n), z(preconditioned ? n : 0);
+
+        while (true) {
+            // Residual of the current iterate
+            A.apply(x, r);
+            for (std::size_t i = 0; i < n; ++i) {
+                r[i] = b[i] - r[i];
+            }
+            const double beta = norm2(r);
+            result.residual = beta / norm_b;
+            if (result.residual <= tol || result.iterations >= max_iter) {
+                break;
+            }
+            V[0] = r;
+            for (auto& value : V[0]) {
+                value /= beta;
+            }
+            std::fill(g.begin(), g.end(), T{0});
+            g[0] = beta;
+
+            std::size_t k = 0;
+            while (k < restart && result.iterations < max_iter) {
+                // Arnoldi step with modified Gram-Schmidt on A M v_k, written directly in v_{k+1}
+                std::vector<T>& w = V[k + 1];
+                if constexpr (preconditioned) {
+                    precondition(M, V[k], z);
+                    A.apply(z, w);
+                } else {
+                    A.apply(V[k], w);
+                }
+                for (std::size_t j = 0; j <= k; ++j) {
+                    H[j][k] = dot(V[j], w);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        w[i] -= H[j][k] * V[j][i];
+                    }
+                }
+                const double h_next = norm2(w);
+                for (auto& value : w) {
+                    value /= (h_next > 0 ? h_next : 1.0);
+                }
+
+                // Apply the previous Givens rotations and compute a new one
+                for (std::size_t j = 0; j < k; ++j) {
+                    const T tmp = conjugate(cs[j]) * H[j][k] + conjugate(sn[j]) * H[j + 1][k];
+                    H[j + 1][k] = -sn[j] * H[j][k] + cs[j] * H[j + 1][k];
+                    H[j][k] = tmp;
+                }
+                const double denom = std::sqrt(std::norm(H[k][k]) + h_next * h_next);
+                cs[k] = H[k][k] / denom;
+                sn[k] = T{h_next} / denom;
+                H[k][k] = denom;
+                g[k + 1] = -sn[k] * g[k];
+                g[k] = conjugate(cs[k]) * g[k];
+
+                ++k;
+                ++result.iterations;
+                result.residual = std::abs(g[k]) / norm_b;
+                if (result.residual <= tol || h_next == 0) {
+                    break;
+                }
+            }
+
+            // Solve the triangular system and update the solution
+            std::vector<T> y(k);
+            for (std::size_t j = k; j-- > 0;) {
+                y[j] = g[j];
+                for (std::size_t l = j + 1; l < k; ++l) {
+                    y[j] -= H[j][l] * y[l];
+                }
+                y[j] /= H[j][j];
+            }
+            std::fill(r.begin(), r.end(), T{0});
+            for (std::size_t j = 0; j < k; ++j) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    r[i] += y[j] * V[j][i];
+                }
+            }
+            if constexpr (preconditioned) {
+                precondition(M, r, z);
+                std::swap(r, z);
+            }
+            for (std::size_t i = 0; i < n; ++i) {
+                x[i] += r[i];
+            }
+        }
+        result.converged = result.residual <= tol;
+        return result;
+    }
+
+} // namespace algebra
+
+#endif // ITERATIVE_SOLVERS_HPP
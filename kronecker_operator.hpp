@@ -0,0 +1,134 @@
+/**
+ * @file kronecker_operator.hpp
+ * @brief Contains KroneckerOperator, the Kronecker product of two compressed matrices applied without forming it.
+ *
+ * Tensor-product discretizations give operators A ⊗ B with nnz(A) * nnz(B) non zero elements. The product
+ * uses the reshape identity: if x holds the cols(A) x cols(B) matrix X by rows, then (A ⊗ B) x holds A X B^T
+ * by rows. It is computed as Z = X B^T (one SpMV with B per row of X) followed by Y = A Z (SpMM with A),
+ * in nnz(B) cols(A) + nnz(A) rows(B) operations instead of nnz(A) nnz(B).
+ */
+
+#ifndef KRONECKER_OPERATOR_HPP
+#define KRONECKER_OPERATOR_HPP
+
+#include "matrix_view.hpp"
+#include <thread>
+
+namespace algebra {
+
+    /**
+     * @brief Kronecker product A ⊗ B of two compressed matrices, which must outlive the operator:
+     * element (iA rows(B) + iB, jA cols(B) + jB) is A(iA, jA) B(iB, jB)
+     *
+     * @tparam T The type of elements in the matrices
+     * @tparam Order The storage order of the matrices
+     */
+    template<RealOrComplex T, StorageOrder Order>
+    class KroneckerOperator {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param A Left factor, in compressed format
+         * @param B Right factor, in compressed format
+         */
+        KroneckerOperator(const MatrixView<T, Order>& A, const MatrixView<T, Order>& B) : A(A), B(B){};
+
+        /**
+         * @brief Constructor from two compressed matrices
+         */
+        KroneckerOperator(const Matrix<T, Order>& A, const Matrix<T, Order>& B)
+            : A(MatrixView<T, Order>(A)), B(MatrixView<T, Order>(B)){};
+
+        /**
+         * @brief Product y = (A ⊗ B) x, with x and y given as spans of cols() and rows() entries (the LinearOperator interface)
+         */
+        void apply(std::span<const T> x, std::span<T> y) const{
+            if (x.size() != cols() || y.size() != rows()) {
+                throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+            }
+            // Z = X B^T: row jA of Z is B times row jA of X
+            std::vector<T> Z(A.cols() * B.rows(), T{0});
+            for (std::size_t jA = 0; jA < A.cols(); ++jA) {
+                compressed_multiply<T, Order>(B.inner_index(), B.outer_index(), B.values(),
+                                              x.subspan(jA * B.cols(), B.cols()),
+                                              std::span<T>(Z).subspan(jA * B.rows(), B.rows()));
+            }
+            // Y = A Z: SpMM with A on the rows of Z
+            std::fill(y.begin(), y.end(), T{0});
+            compressed_multiply_block<T, Order>(A.inner_index(), A.outer_index(), A.values(), Z, B.rows(), y);
+        }
+
+        /**
+         * @brief Operator-vector product
+         */
+        std::vector<T> operator*(const std::vector<T>& x) const{
+            std::vector<T> y(rows());
+            apply(x, y);
+            return y;
+        }
+
+        /**
+         * @brief Forms A ⊗ B as a compressed Matrix; the rows (columns for ColumnOrdering) are filled in parallel
+         *
+         * @param max_nonzeros Largest accepted number of non zero elements: above it std::length_error is thrown
+         * @param threads Number of threads
+         */
+        Matrix<T, Order> to_matrix(std::size_t max_nonzeros = std::size_t{1} << 27,
+                                   std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1)) const{
+            if (A.nonzeros() != 0 && B.nonzeros() > max_nonzeros / A.nonzeros()) {
+                throw std::length_error("The Kronecker product is too large to be formed.");
+            }
+            // The compressed arrays of A ⊗ B are the Kronecker products of those of A and B, in both orders:
+            // row (column) (a, b) holds the entries (ka, kb) for ka in row a of A and kb in row b of B
+            auto inner_A = A.inner_index(), inner_B = B.inner_index();
+            const std::size_t nA = inner_A.size() - 1, nB = inner_B.size() - 1;
+            const std::size_t extent_B = (Order == StorageOrder::RowOrdering) ? B.cols() : B.rows();
+            std::pmr::vector<std::size_t> inner(nA * nB + 1, 0), outer(A.nonzeros() * B.nonzeros());
+            std::pmr::vector<T> data(outer.size());
+            for (std::size_t a = 0; a < nA; ++a) {
+                for (std::size_t b = 0; b < nB; ++b) {
+                    inner[a * nB + b + 1] = inner[a * nB + b] + (inner_A[a + 1] - inner_A[a]) * (inner_B[b + 1] - inner_B[b]);
+                }
+            }
+            auto fill = [&](std::size_t first, std::size_t last){
+                for (std::size_t a = first; a < last; ++a) {
+                    for (std::size_t b = 0; b < nB; ++b) {
+                        std::size_t pos = inner[a * nB + b];
+                        for (std::size_t ka = inner_A[a]; ka < inner_A[a + 1]; ++ka) {
+                            for (std::size_t kb = inner_B[b]; kb < inner_B[b + 1]; ++kb, ++pos) {
+                                outer[pos] = A.outer_index()[ka] * extent_B + B.outer_index()[kb];
+                                data[pos] = A.values()[ka] * B.values()[kb];
+                            }
+                        }
+                    }
+                }
+            };
+            const std::size_t nthreads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(nA, 1));
+            std::vector<std::thread> workers;
+            for (std::size_t t = 1; t < nthreads; ++t) {
+                workers.emplace_back(fill, nA * t / nthreads, nA * (t + 1) / nthreads);
+            }
+            fill(0, nA / nthreads);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            return Matrix<T, Order>(rows(), cols(), std::move(inner), std::move(outer), std::move(data));
+        }
+
+        std::size_t rows() const{ return A.rows() * B.rows();};
+        std::size_t cols() const{ return A.cols() * B.cols();};
+
+        /**
+         * @brief Utility: number of non zero elements of A ⊗ B (not stored)
+         */
+        std::size_t nonzeros() const{ return A.nonzeros() * B.nonzeros();};
+
+    private:
+        MatrixView<T, Order> A; //!< left factor
+        MatrixView<T, Order> B; //!< right factor
+    };
+
+} // namespace algebra
+
+#endif // KRONECKER_OPERATOR_HPP
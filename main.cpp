@@ -1,6 +1,17 @@
 #include <iostream>
 #include "sparse_matrix.hpp"
+#include "shared_matrix.hpp"
+#include "iterative_solvers.hpp"
+#include "versioned_matrix.hpp"
+#include "boolean_matrix.hpp"
+#include "vector_expressions.hpp"
+#include "static_matrix.hpp"
+#include "batched_matrix.hpp"
+#include "block_operator.hpp"
+#include "kronecker_operator.hpp"
+#include "domain_decomposition.hpp"
 #include <chrono>
+#include <utility>
 
 
 
@@ -133,6 +144,21 @@ int main() {
     std::cout << ("The operation takes") << " : " << delta_t_5.count() << " ms" << std::endl;
 
 
+    std::cout<<"\n-> Publishing the compressed matrix in shared memory..."<<std::endl;
+    {
+        auto published = algebra::SharedMatrix<double, algebra::StorageOrder::RowOrdering>::publish(M1, "/pacs_lnsp_131");
+        // any other process on the node can attach to the same segment
+        auto attached = algebra::SharedMatrix<double, algebra::StorageOrder::RowOrdering>::attach("/pacs_lnsp_131");
+        std::vector<double> res_shared = attached.view()*randomV;
+        double max_diff{0};
+        for (std::size_t i = 0; i < res_shared.size(); ++i) {
+            max_diff = std::max(max_diff, std::abs(res_shared[i] - res_compressed[i]));
+        }
+        std::cout<<"Handles attached to the segment: "<<attached.references()<<std::endl;
+        std::cout<<"M*v with the shared (zero-copy) view, max difference: "<<max_diff<<std::endl;
+    }
+
+
     std::cout<<"\n\n\n## Test with a sparse matrix stored in COLUMN ordering ##"<<std::endl;
     
     //initialization of the matrix
@@ -213,6 +239,657 @@ int main() {
     std::cout << "Infinity-Norm of complexMatrix (Uncompressed): " << complexMatrix.norm<algebra::NormType::Infinity>() << std::endl;
     std::cout << "Frobenius-Norm of complexMatrix (Uncompressed): " << complexMatrix.norm<algebra::NormType::Frobenius>() << std::endl;
 
+
+
+
+    /// ####################    VIEW OVER EXTERNAL ARRAYS   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH A VIEW OVER EXTERNAL CSR ARRAYS   ####"<<std::endl;
+
+    // CSR arrays of the small matrix A, owned by "another component"
+    const std::vector<std::size_t> row_ptr = {0, 2, 4, 6, 7, 8};
+    const std::vector<std::size_t> col_idx = {0, 2, 0, 1, 1, 2, 1, 0};
+    const std::vector<double> vals = {1, 3, 4, 5, 8, 6, 1, 2};
+    algebra::MatrixView<double, algebra::StorageOrder::RowOrdering> V(5, 3, row_ptr, col_idx, vals);
+
+    std::cout << "One-Norm of the view: " << V.norm<algebra::NormType::One>() << std::endl;
+    std::cout << "Infinity-Norm of the view: " << V.norm<algebra::NormType::Infinity>() << std::endl;
+    std::cout << "Frobenius-Norm of the view: " << V.norm<algebra::NormType::Frobenius>() << std::endl;
+    std::cout << "V(2,1) = " << V(2,1) << ", V(3,2) = " << V(3,2) << std::endl;
+    std::vector<double> res_view = V*v;
+    std::cout<<"V*v, same result as A*v: "<<std::boolalpha<<(res_view == A*v)<<std::endl;
+
+    // A view can be passed to the solvers
+    std::vector<double> b_view = M1*randomV, x_view(M1.rows(), 0.0);
+    auto gmres_result = algebra::gmres(algebra::MatrixView<double, algebra::StorageOrder::RowOrdering>(M1), b_view, x_view, 1e-10, 500, 131);
+    std::cout<<"GMRES on a view of the big matrix: "<<gmres_result.iterations<<" iterations, relative residual "<<gmres_result.residual<<std::endl;
+
+
+
+    /// ####################    ASSEMBLY WITH AN ARENA   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE ASSEMBLY WITH AN ARENA   ####"<<std::endl;
+
+    // Assembly of the 5-point Laplacian on a N x N grid, then compression
+    const std::size_t N = 300;
+    auto assemble = [N](algebra::Matrix<double, algebra::StorageOrder::RowOrdering>& L){
+        for (std::size_t k = 0; k < N*N; ++k) {
+            const std::size_t i = k / N, j = k % N;
+            if (i > 0) L(k, k - N) = -1;
+            if (j > 0) L(k, k - 1) = -1;
+            L(k, k) = 4;
+            if (j + 1 < N) L(k, k + 1) = -1;
+            if (i + 1 < N) L(k, k + N) = -1;
+        }
+        L.compress();
+    };
+
+    auto t0_8 = std::chrono::high_resolution_clock::now();
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> L1(N*N, N*N);
+    assemble(L1);
+    auto t1_8 = std::chrono::high_resolution_clock::now();
+
+    algebra::AssemblyArena arena(5*N*N*64);
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> L2(N*N, N*N, &arena);
+    assemble(L2);
+    auto t2_8 = std::chrono::high_resolution_clock::now();
+
+    std::vector<double> ones(N*N, 1.0);
+    std::vector<double> r1 = L1*ones, r2 = L2*ones;
+    std::cout<<"Laplacian with "<<L2.nonzeros()<<" non zeros, same product: "<<std::boolalpha<<(r1 == r2)<<std::endl;
+    std::cout<<"Assembly and compression with the default allocator: "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(t1_8-t0_8).count()<<" us"<<std::endl;
+    std::cout<<"Assembly and compression with the arena: "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(t2_8-t1_8).count()<<" us"<<std::endl;
+
+
+    /// ####################    SHARED SPARSITY PATTERN   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE SHARED SPARSITY PATTERN   ####"<<std::endl;
+
+    // Mass matrix on the pattern of the Laplacian: only the values are stored
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> Mass(L1.pattern(), 0.0);
+    auto mass_values = Mass.values();
+    for (std::size_t k = 0; k < mass_values.size(); ++k) {
+        mass_values[k] = (std::as_const(L1).values()[k] > 0) ? 1.0 : 0.0;
+    }
+    // System matrix of an implicit Euler step: M + dt*L, a single loop over the values
+    auto S = algebra::linear_combination(1.0, Mass, 0.1, L1);
+    std::cout<<"L1, Mass and S share the pattern: "<<std::boolalpha<<(Mass.pattern() == L1.pattern() && S.pattern() == L1.pattern())
+             <<", S(0,0) = "<<std::as_const(S)(0,0)<<", S(0,1) = "<<std::as_const(S)(0,1)<<std::endl;
+
+    // Products of the three matrices in one pass over the pattern, and product of M + dt*L without forming it
+    auto products = algebra::multiply_shared<double, algebra::StorageOrder::RowOrdering>({&L1, &Mass, &S}, ones);
+    std::vector<double> combination = algebra::multiply_combination<double, algebra::StorageOrder::RowOrdering>({1.0, 0.1}, {&Mass, &L1}, ones);
+    // the sums may be grouped differently from operator*: compare within a tolerance
+    auto max_difference = [](const std::vector<double>& a, const std::vector<double>& b){
+        double difference = 0;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            difference = std::max(difference, std::abs(a[i] - b[i]));
+        }
+        return difference;
+    };
+    const double products_difference = std::max({max_difference(products[0], L1*ones), max_difference(products[1], Mass*ones),
+                                                 max_difference(products[2], S*ones)});
+    std::cout<<"Products in one pass, same results: "<<std::boolalpha<<(products_difference < 1e-12)
+             <<", (M + dt*L)*v without forming the matrix: "<<(max_difference(combination, S*ones) < 1e-12)<<std::endl;
+
+
+
+    /// ####################    COPY-ON-WRITE   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE COPY-ON-WRITE SNAPSHOTS   ####"<<std::endl;
+
+    // Snapshots share the storage of S: no copy of the values
+    auto t0_10 = std::chrono::high_resolution_clock::now();
+    const std::vector<algebra::Matrix<double, algebra::StorageOrder::RowOrdering>> snapshots(100, S);
+    auto t1_10 = std::chrono::high_resolution_clock::now();
+    std::cout<<"100 snapshots of a matrix with "<<S.nonzeros()<<" non zeros: "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(t1_10-t0_10).count()<<" us"<<std::endl;
+    // The first modification makes a private copy, the snapshots are not affected
+    S(0,0) = 10;
+    std::cout<<"S(0,0) = "<<S(0,0)<<", snapshot(0,0) = "<<snapshots.front()(0,0)<<std::endl;
+
+
+
+    /// ####################    VERSIONED MATRIX (RCU)   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE VERSIONED MATRIX   ####"<<std::endl;
+
+    // Four readers run SpMV on the current version while the writer publishes 20 new versions
+    algebra::VersionedMatrix<double, algebra::StorageOrder::RowOrdering> online(L1);
+    std::atomic<bool> stop{false};
+    std::atomic<std::size_t> products_done{0}, inconsistent{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&](){
+            while (!stop.load()) {
+                auto version = online.read();
+                // Every version is a scaled Laplacian: zero sum on the interior rows, -2 times an off diagonal entry at the corner
+                std::vector<double> y = (*version)*ones;
+                if (y[N+1] != 0.0 || y[0] != -2*(*version)(0,1)) {
+                    ++inconsistent;
+                }
+                ++products_done;
+            }
+        });
+    }
+    for (int k = 1; k <= 20; ++k) {
+        online.update([k](auto& M){
+            for (auto& value : M.values()) {
+                value *= 1.0 + 1.0 / k;
+            }
+        });
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    std::cout<<"Versions published: "<<online.version()<<", products by the readers: "<<(products_done > 0)
+             <<", inconsistent versions seen: "<<inconsistent<<", versions not reclaimed: "<<online.retired_versions()<<std::endl;
+
+
+
+    /// ####################    VALUE ENCODING   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE VALUE ENCODING   ####"<<std::endl;
+
+    // The Laplacian has two distinct values: 8 bit codes into a table
+    auto L_encoded = L1;
+    L_encoded.encode(algebra::ValueEncoding::Automatic);
+    // The adjacency matrix of the grid (with self loops) has only ones: no values at all
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> adjacency(L1.pattern(), 1.0);
+    adjacency.encode(algebra::ValueEncoding::Automatic);
+    std::cout<<"Laplacian with 8 bit codes: "<<std::boolalpha<<(L_encoded.encoding() == algebra::ValueEncoding::Dictionary8)
+             <<", same product: "<<(L_encoded*ones == L1*ones)
+             <<", same One-Norm: "<<(L_encoded.norm<algebra::NormType::One>() == L1.norm<algebra::NormType::One>())<<std::endl;
+    std::cout<<"Adjacency matrix stored as a pattern: "<<(adjacency.encoding() == algebra::ValueEncoding::Pattern)
+             <<", degree of the first vertex: "<<(adjacency*ones)[0]<<std::endl;
+
+
+
+    /// ####################    BOOLEAN MATRIX   ################################
+
+    std::cout<<"\n\n\n\n####  TEST OF THE BOOLEAN MATRIX   ####"<<std::endl;
+
+    // Breadth first search on the grid graph: one SpMSpV per level
+    algebra::BooleanMatrix grid(L1);
+    std::vector<std::size_t> frontier = {0};
+    algebra::Bitset visited = algebra::make_bitset(frontier, N*N);
+    std::size_t levels = 0;
+    while (!frontier.empty()) {
+        frontier = grid.multiply_sparse(frontier);
+        std::erase_if(frontier, [&visited](std::size_t v){ return (visited[v / 64] >> (v % 64)) & 1;});
+        for (std::size_t v : frontier) {
+            visited[v / 64] |= std::uint64_t{1} << (v % 64);
+        }
+        levels += !frontier.empty();
+    }
+    std::cout<<"BFS on the "<<N<<" x "<<N<<" grid: "<<levels<<" levels (expected "<<2*(N-1)<<"), "
+             <<algebra::bitset_indices(visited).size()<<" vertices reached"<<std::endl;
+
+    // Graph of 100 cliques of 64 vertices: every row is a single bitmap block
+    std::vector<std::size_t> clique_ptr = {0}, clique_cols;
+    for (std::size_t v = 0; v < 6400; ++v) {
+        for (std::size_t w = v / 64 * 64; w < v / 64 * 64 + 64; ++w) {
+            clique_cols.push_back(w);
+        }
+        clique_ptr.push_back(clique_cols.size());
+    }
+    algebra::BooleanMatrix cliques(6400, 6400, clique_ptr, clique_cols);
+    std::vector<std::size_t> some_vertices = {0, 1, 2, 100};
+    std::cout<<"Cliques: "<<cliques.nonzeros()<<" entries in "<<cliques.blocks()<<" bitmap blocks, "<<cliques.storage_bytes()
+             <<" bytes instead of "<<cliques.nonzeros()*(sizeof(std::size_t) + sizeof(double))<<"; neighbours of vertex 0 among {0,1,2,100}: "
+             <<cliques.count(algebra::make_bitset(some_vertices, 6400))[0]<<std::endl;
+
+    // Pattern of a Matrix Market file
+    auto pattern_131 = algebra::BooleanMatrix::read("lnsp_131.mtx");
+    std::cout<<"Pattern read from file: "<<pattern_131.nonzeros()<<" entries, entry (0,0): "<<pattern_131(0,0)<<std::endl;
+
+
+
+    /// ####################    OTHER ELEMENT TYPES   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH OTHER ELEMENT TYPES   ####"<<std::endl;
+
+    // The Laplacian in single precision and with integer entries
+    algebra::Matrix<float, algebra::StorageOrder::RowOrdering> L_float(N*N, N*N);
+    algebra::Matrix<int, algebra::StorageOrder::ColumnOrdering> L_int(N*N, N*N);
+    for (std::size_t k = 0; k < N*N; ++k) {
+        L_float(k, k) = 4;
+        L_int(k, k) = 4;
+        if (k % N > 0) {
+            L_float(k, k - 1) = -1;
+            L_int(k, k - 1) = -1;
+        }
+    }
+    L_float.compress();
+    L_int.compress();
+    std::vector<float> ones_float(N*N, 1.0f);
+    std::vector<int> ones_int(N*N, 1);
+    std::cout<<"float: One-Norm "<<L_float.norm<algebra::NormType::One>()<<", (L*v)[1] = "<<(L_float*ones_float)[1]
+             <<"; int: One-Norm "<<L_int.norm<algebra::NormType::One>()<<", (L*v)[1] = "<<(L_int*ones_int)[1]<<std::endl;
+    algebra::Matrix<std::complex<float>, algebra::StorageOrder::RowOrdering> C_float(2, 2);
+    C_float(0,0) = {1.0f, 1.0f};
+    C_float(1,1) = {0.0f, 2.0f};
+    C_float.compress();
+    std::vector<std::complex<float>> random_complex = algebra::generateRandomVector(C_float);
+    std::cout<<"std::complex<float>: Frobenius-Norm "<<C_float.norm<algebra::NormType::Frobenius>()
+             <<", product with a random vector of length "<<(C_float*random_complex).size()<<std::endl;
+
+
+
+    /// ####################    LAZY VECTOR EXPRESSIONS   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH LAZY VECTOR EXPRESSIONS   ####"<<std::endl;
+
+    // r = b - (L1*x + alpha*w): step by step with temporaries, then fused in one pass over the rows
+    std::vector<double> x_lazy = algebra::generateRandomVector(L1), w_lazy = algebra::generateRandomVector(L1);
+    std::vector<double> b_lazy = L1 * ones;
+    const double alpha_lazy = 0.5;
+    std::vector<double> r_eager, r_fused;
+    auto start_eager = std::chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < 20; ++rep) {
+        std::vector<double> y = L1 * x_lazy;
+        std::vector<double> z(y.size());
+        for (std::size_t i = 0; i < y.size(); ++i) {
+            z[i] = y[i] + alpha_lazy * w_lazy[i];
+        }
+        r_eager.assign(b_lazy.size(), 0.0);
+        for (std::size_t i = 0; i < z.size(); ++i) {
+            r_eager[i] = b_lazy[i] - z[i];
+        }
+    }
+    auto end_eager = std::chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < 20; ++rep) {
+        algebra::assign(r_fused, b_lazy - (algebra::lazy(L1) * x_lazy + alpha_lazy * algebra::lazy(w_lazy)));
+    }
+    auto end_fused = std::chrono::high_resolution_clock::now();
+    double difference = 0;
+    for (std::size_t i = 0; i < r_eager.size(); ++i) {
+        difference = std::max(difference, std::abs(r_eager[i] - r_fused[i]));
+    }
+    std::cout<<"Residual with temporaries: "<<std::chrono::duration_cast<std::chrono::microseconds>(end_eager - start_eager).count()/20
+             <<" us, fused: "<<std::chrono::duration_cast<std::chrono::microseconds>(end_fused - end_eager).count()/20
+             <<" us, max difference "<<difference<<std::endl;
+
+    // A column ordered matrix is multiplied when the expression is built, the element-wise part is still fused
+    std::vector<double> eager_column = M2 * randomV;
+    std::vector<double> difference_column = algebra::evaluate(2.0 * (algebra::lazy(M2) * randomV) - eager_column);
+    std::cout<<"Column ordering: |2*(M*v) - M*v| = "<<algebra::norm2(difference_column)<<", |M*v| = "<<algebra::norm2(eager_column)<<std::endl;
+
+
+
+    /// ####################    STATIC SPARSE MATRICES   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH STATIC SPARSE MATRICES   ####"<<std::endl;
+
+    // Stiffness matrix of a linear 1D element, built and applied at compile time
+    constexpr auto element_pattern = algebra::dense_static_pattern<2, 2>();
+    using Element = algebra::StaticSparseMatrix<double, 2, 2, element_pattern>;
+    constexpr Element K_element(std::array<double, 4>{1.0, -1.0, -1.0, 1.0});
+    static_assert((K_element * std::array<double, 2>{1.0, 1.0})[0] == 0.0, "Constants are in the kernel of the element matrix.");
+
+    // Assembly of the 1D Laplacian with N elements
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> L_1d(N + 1, N + 1);
+    for (std::size_t e = 0; e < N; ++e) {
+        K_element.add_to(L_1d, {e, e + 1}, {e, e + 1});
+    }
+    L_1d.compress();
+    std::cout<<"1D Laplacian assembled from "<<N<<" static element matrices: "<<L_1d.nonzeros()<<" non zeros, L(1,1) = "<<L_1d(1,1)<<std::endl;
+
+    // 8x8 element matrix with a known pattern (the two blocks of 4 nodes are coupled only by the diagonal)
+    constexpr auto block_pattern = algebra::make_static_pattern<8, 8>(std::to_array<std::array<std::size_t, 2>>({
+        {0,0},{0,1},{0,2},{0,3},{0,4}, {1,0},{1,1},{1,2},{1,3},{1,5}, {2,0},{2,1},{2,2},{2,3},{2,6}, {3,0},{3,1},{3,2},{3,3},{3,7},
+        {4,4},{4,5},{4,6},{4,7},{4,0}, {5,4},{5,5},{5,6},{5,7},{5,1}, {6,4},{6,5},{6,6},{6,7},{6,2}, {7,4},{7,5},{7,6},{7,7},{7,3}}));
+    algebra::StaticSparseMatrix<double, 8, 8, block_pattern> K8;
+    for (std::size_t k = 0; k < K8.nonzeros(); ++k) {
+        K8.values()[k] = 1.0 + 0.01 * k;
+    }
+    auto K8_matrix = K8.to_matrix();
+    algebra::StaticSparseMatrix<double, 8, 8, block_pattern> K8_back(K8_matrix);
+    std::array<double, 8> x8{1, 2, 3, 4, 5, 6, 7, 8};
+    std::vector<double> x8_vector(x8.begin(), x8.end());
+    const int applications = 1000000;
+    double sum_static = 0, sum_dynamic = 0;
+    auto start_static = std::chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < applications; ++rep) {
+        x8[rep % 8] += 1e-9;
+        sum_static += (K8 * x8)[rep % 8];
+    }
+    auto end_static = std::chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < applications; ++rep) {
+        x8_vector[rep % 8] += 1e-9;
+        sum_dynamic += (K8_matrix * x8_vector)[rep % 8];
+    }
+    auto end_dynamic = std::chrono::high_resolution_clock::now();
+    std::cout<<applications<<" products with an 8x8 matrix of "<<K8.nonzeros()<<" entries: static "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(end_static - start_static).count()<<" us, Matrix "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(end_dynamic - end_static).count()<<" us (difference of the results "
+             <<std::abs(sum_static - sum_dynamic)<<"); entry (5,1) read back from the Matrix: "<<K8_back.entry<5, 1>()<<std::endl;
+
+
+
+    /// ####################    BATCHED SMALL MATRICES   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH BATCHED SMALL MATRICES   ####"<<std::endl;
+
+    // 1000 systems of size 50: 1D Laplacians shifted by a different amount, every tenth with an extra coupling
+    const std::size_t batch_size = 1000, small_n = 50;
+    std::vector<algebra::Matrix<double, algebra::StorageOrder::RowOrdering>> small_items;
+    for (std::size_t b = 0; b < batch_size; ++b) {
+        algebra::Matrix<double, algebra::StorageOrder::RowOrdering> item(small_n, small_n);
+        for (std::size_t i = 0; i < small_n; ++i) {
+            item(i, i) = 2.0 + 0.001 * static_cast<double>(b);
+            if (i > 0) {
+                item(i, i - 1) = -1.0;
+            }
+            if (i + 1 < small_n) {
+                item(i, i + 1) = -1.0;
+            }
+        }
+        if (b % 10 == 0) {
+            item(0, small_n - 1) = -0.5;
+        }
+        item.compress();
+        small_items.push_back(std::move(item));
+    }
+    algebra::BatchedMatrix<double> batched(small_items);
+    std::vector<double> batched_rhs(small_n * batch_size, 1.0);
+    algebra::BatchedLU<double> batched_lu(batched);
+    std::vector<double> batched_x = batched_lu.solve(batched_rhs);
+    std::vector<double> batched_r = batched * batched_x;
+    double batched_residual = 0;
+    for (std::size_t k = 0; k < batched_r.size(); ++k) {
+        batched_residual = std::max(batched_residual, std::abs(batched_r[k] - batched_rhs[k]));
+    }
+    std::cout<<batch_size<<" systems on the union pattern of "<<batched.nonzeros()<<" entries, "<<batched_lu.nonzeros()
+             <<" entries in the LU factors of each item, max residual "<<batched_residual<<std::endl;
+    std::vector<double> batched_krylov(small_n * batch_size, 0.0);
+    auto batched_results = algebra::bicgstab_batched<double>(batched, batched_rhs, batched_krylov, 1e-10);
+    std::cout<<"Batched BiCGSTAB: item 0 in "<<batched_results[0].iterations<<" iterations, item 999 in "
+             <<batched_results[999].iterations<<"; x_0 of item 5: "<<algebra::unpack_item<double>(batched_krylov, batch_size, 5)[0]
+             <<" (LU: "<<algebra::unpack_item<double>(batched_x, batch_size, 5)[0]<<")"<<std::endl;
+
+
+
+    /// ####################    BLOCK OPERATORS   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH BLOCK OPERATORS   ####"<<std::endl;
+
+    // Saddle point system [A B^T; B 0]: A is a shifted 1D Laplacian (a time step of a diffusion problem),
+    // B takes the differences of consecutive pairs
+    const std::size_t nu = 400, np = nu / 2;
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> A_block(nu, nu), B_block(np, nu);
+    for (std::size_t i = 0; i < nu; ++i) {
+        A_block(i, i) = 3.0;
+        if (i > 0) {
+            A_block(i, i - 1) = -1.0;
+        }
+        if (i + 1 < nu) {
+            A_block(i, i + 1) = -1.0;
+        }
+    }
+    for (std::size_t i = 0; i < np; ++i) {
+        B_block(i, 2 * i) = 1.0;
+        B_block(i, 2 * i + 1) = -1.0;
+    }
+    A_block.compress();
+    B_block.compress();
+    algebra::BlockOperator<double> saddle({nu, np}, {nu, np});
+    saddle.set_block(0, 0, A_block);
+    saddle.set_block(0, 1, B_block, 1.0, true);
+    saddle.set_block(1, 0, B_block);
+
+    // Same product with the assembled monolithic matrix
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> monolithic(nu + np, nu + np);
+    const auto& A_const = A_block;
+    for (std::size_t i = 0; i < nu; ++i) {
+        for (std::size_t j = 0; j < nu; ++j) {
+            if (A_const(i, j) != 0.0) {
+                monolithic(i, j) = A_const(i, j);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < np; ++i) {
+        monolithic(nu + i, 2 * i) = monolithic(2 * i, nu + i) = 1.0;
+        monolithic(nu + i, 2 * i + 1) = monolithic(2 * i + 1, nu + i) = -1.0;
+    }
+    monolithic.compress();
+    std::vector<double> saddle_x = algebra::generateRandomVector(monolithic);
+    std::vector<double> saddle_y = saddle * saddle_x, monolithic_y = monolithic * saddle_x;
+    double saddle_difference = 0;
+    for (std::size_t i = 0; i < saddle_y.size(); ++i) {
+        saddle_difference = std::max(saddle_difference, std::abs(saddle_y[i] - monolithic_y[i]));
+    }
+    std::cout<<"Block operator of size "<<saddle.rows()<<" referencing 2 matrices, max difference with the monolithic product: "
+             <<saddle_difference<<std::endl;
+
+    // GMRES without preconditioner and with diag(Jacobi of A, Schur complement B diag(A)^-1 B^T, a multiple of I)
+    std::vector<double> saddle_b(nu + np, 1.0), saddle_plain, saddle_preconditioned;
+    auto plain_result = algebra::gmres(saddle, saddle_b, saddle_plain, 1e-8, 2000, 50);
+    algebra::BlockDiagonalPreconditioner<double> block_jacobi(saddle, std::vector<const decltype(A_block)*>{&A_block, nullptr});
+    block_jacobi.set_block(1, [](std::span<const double> r, std::span<double> y){
+        for (std::size_t i = 0; i < r.size(); ++i) {
+            y[i] = 1.5 * r[i];
+        }
+    });
+    auto preconditioned_result = algebra::gmres(saddle, saddle_b, saddle_preconditioned, 1e-8, 2000, 50, block_jacobi);
+    std::cout<<"GMRES on the saddle point system: "<<plain_result.iterations<<" iterations, with the block diagonal preconditioner: "
+             <<preconditioned_result.iterations<<" (residual "<<preconditioned_result.residual<<")"<<std::endl;
+
+
+
+    /// ####################    KRONECKER PRODUCTS   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH KRONECKER PRODUCTS   ####"<<std::endl;
+
+    // The 5-point Laplacian L1 is T ⊗ I + I ⊗ T, with T the 1D Laplacian with diagonal 2
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> T_1d(N, N), I_1d(N, N);
+    for (std::size_t i = 0; i < N; ++i) {
+        T_1d(i, i) = 2.0;
+        I_1d(i, i) = 1.0;
+        if (i > 0) {
+            T_1d(i, i - 1) = -1.0;
+        }
+        if (i + 1 < N) {
+            T_1d(i, i + 1) = -1.0;
+        }
+    }
+    T_1d.compress();
+    I_1d.compress();
+    algebra::KroneckerOperator<double, algebra::StorageOrder::RowOrdering> TI(T_1d, I_1d), IT(I_1d, T_1d);
+    std::vector<double> kron_x = algebra::generateRandomVector(L1);
+    auto start_kron = std::chrono::high_resolution_clock::now();
+    std::vector<double> kron_y = algebra::evaluate(algebra::lazy(TI * kron_x) + IT * kron_x);
+    auto end_kron = std::chrono::high_resolution_clock::now();
+    std::vector<double> L1_y = L1 * kron_x;
+    auto end_L1 = std::chrono::high_resolution_clock::now();
+    double kron_difference = 0;
+    for (std::size_t i = 0; i < kron_y.size(); ++i) {
+        kron_difference = std::max(kron_difference, std::abs(kron_y[i] - L1_y[i]));
+    }
+    std::cout<<"(T x I + I x T) v with two Kronecker operators ("<<T_1d.nonzeros() + I_1d.nonzeros()<<" stored non zeros): "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(end_kron - start_kron).count()<<" us, with the assembled Laplacian ("
+             <<L1.nonzeros()<<" non zeros): "<<std::chrono::duration_cast<std::chrono::microseconds>(end_L1 - end_kron).count()
+             <<" us, max difference "<<kron_difference<<std::endl;
+
+    // Explicit construction, allowed only below a size limit
+    auto TI_matrix = TI.to_matrix();
+    std::cout<<"T x I formed explicitly: "<<TI_matrix.nonzeros()<<" non zeros, element (N, 0) = "<<TI_matrix(N, 0)<<std::endl;
+    try {
+        auto too_large = TI.to_matrix(1000);
+    } catch (const std::length_error& e) {
+        std::cout<<"With a limit of 1000 non zeros: "<<e.what()<<std::endl;
+    }
+
+
+
+    /// ####################    MATRIX-FREE OPERATORS   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH MATRIX-FREE OPERATORS   ####"<<std::endl;
+
+    // The 5-point Laplacian applied as a stencil, without storing any matrix
+    struct Stencil {
+        std::size_t n;
+        std::size_t rows() const{ return n * n;}
+        std::size_t cols() const{ return n * n;}
+        void apply(std::span<const double> x, std::span<double> y) const{
+            for (std::size_t k = 0; k < n * n; ++k) {
+                const std::size_t i = k / n, j = k % n;
+                y[k] = 4 * x[k] - (i > 0 ? x[k - n] : 0.0) - (j > 0 ? x[k - 1] : 0.0)
+                     - (j + 1 < n ? x[k + 1] : 0.0) - (i + 1 < n ? x[k + n] : 0.0);
+            }
+        }
+    };
+    static_assert(algebra::LinearOperator<Stencil, double>);
+    static_assert(algebra::LinearOperator<decltype(L1), double>);
+    static_assert(algebra::LinearOperator<algebra::MatrixView<double, algebra::StorageOrder::RowOrdering>, double>);
+    static_assert(algebra::LinearOperator<algebra::BlockOperator<double>, double>);
+    static_assert(algebra::LinearOperator<decltype(TI), double>);
+
+    std::vector<double> free_b = L1 * ones, free_x, matrix_x;
+    auto start_free = std::chrono::high_resolution_clock::now();
+    auto free_result = algebra::cg(Stencil{N}, free_b, free_x, 1e-8, 2000);
+    auto end_free = std::chrono::high_resolution_clock::now();
+    auto matrix_result = algebra::cg(L1, free_b, matrix_x, 1e-8, 2000);
+    auto end_matrix = std::chrono::high_resolution_clock::now();
+    std::cout<<"CG with the matrix-free stencil: "<<free_result.iterations<<" iterations in "
+             <<std::chrono::duration_cast<std::chrono::microseconds>(end_free - start_free).count()<<" us; with the compressed Laplacian: "
+             <<matrix_result.iterations<<" iterations in "<<std::chrono::duration_cast<std::chrono::microseconds>(end_matrix - end_free).count()
+             <<" us; |x - 1| = "<<algebra::norm2(algebra::evaluate(algebra::lazy(free_x) - ones))<<std::endl;
+
+
+
+    /// ####################    ROW RANGES AND SUBMATRICES   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH ROW RANGES AND SUBMATRICES   ####"<<std::endl;
+
+    // Product of L1 computed range by range: the views share the arrays of L1
+    std::vector<double> range_x = algebra::generateRandomVector(L1), range_y(N*N);
+    for (std::size_t part = 0; part < 4; ++part) {
+        auto rows_view = algebra::row_range(L1, N*N*part/4, N*N*(part + 1)/4);
+        rows_view.apply(range_x, std::span<double>(range_y).subspan(N*N*part/4, rows_view.rows()));
+    }
+    std::vector<double> full_y = L1 * range_x;
+    std::cout<<"L1*v by 4 row ranges, norm of the difference: "<<algebra::norm2(algebra::evaluate(algebra::lazy(range_y) - full_y))
+             <<", first range shares the values of L1: "<<(algebra::row_range(L1, 0, N).values().data() == L1.values().data())<<std::endl;
+
+    // Block of the unknowns of the left half of the grid (a subdomain) and its coupling with the right half
+    std::vector<std::size_t> left, right;
+    for (std::size_t k = 0; k < N*N; ++k) {
+        (k % N < N / 2 ? left : right).push_back(k);
+    }
+    auto start_extract = std::chrono::high_resolution_clock::now();
+    auto A_left = algebra::submatrix(L1, left, left);
+    auto A_coupling = algebra::submatrix(L1, left, right);
+    auto end_extract = std::chrono::high_resolution_clock::now();
+    std::cout<<"Submatrices extracted in "<<std::chrono::duration_cast<std::chrono::microseconds>(end_extract - start_extract).count()
+             <<" us: left block "<<A_left.rows()<<" x "<<A_left.cols()<<" with "<<A_left.nonzeros()<<" non zeros, coupling with "
+             <<A_coupling.nonzeros()<<" non zeros (expected "<<N<<"), A_left(1,0) = "<<A_left(1,0)<<std::endl;
+
+
+
+    /// ####################    ADDITIVE SCHWARZ   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH ADDITIVE SCHWARZ   ####"<<std::endl;
+
+    // Laplacian on a 100 x 100 grid, GMRES(50) with no preconditioner, global ILU(0) and RAS
+    const std::size_t n_grid = 100;
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> L_grid(n_grid*n_grid, n_grid*n_grid);
+    for (std::size_t k = 0; k < n_grid*n_grid; ++k) {
+        const std::size_t i = k / n_grid, j = k % n_grid;
+        L_grid(k, k) = 4;
+        if (i > 0) L_grid(k, k - n_grid) = -1;
+        if (j > 0) L_grid(k, k - 1) = -1;
+        if (j + 1 < n_grid) L_grid(k, k + 1) = -1;
+        if (i + 1 < n_grid) L_grid(k, k + n_grid) = -1;
+    }
+    L_grid.compress();
+    std::vector<double> grid_b = algebra::generateRandomVector(L_grid);
+    auto run_gmres = [&](const std::string& name, const auto& M){
+        std::vector<double> x;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto result = algebra::gmres(L_grid, grid_b, x, 1e-8, 5000, 50, M);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout<<"GMRES "<<name<<": "<<result.iterations<<" iterations in "
+                 <<std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()<<" us"<<std::endl;
+    };
+    run_gmres("without preconditioner", algebra::IdentityPreconditioner{});
+    run_gmres("with ILU(0)", algebra::ILU0<double>(L_grid));
+    // The local solves run on threads created with the preconditioner: RAS is faster than ILU(0) only with
+    // one core per subdomain, on a single core the threads just add a wake-up per application
+    run_gmres("with RAS, 4 subdomains, overlap 2, ILU(0)", algebra::AdditiveSchwarz<double>(L_grid, 4, 2));
+    run_gmres("with RAS, 16 subdomains, overlap 2, ILU(0)", algebra::AdditiveSchwarz<double>(L_grid, 16, 2));
+
+    // Exact local solves: more subdomains need more iterations, more overlap fewer
+    for (std::size_t domains : {2, 8}) {
+        for (std::size_t overlap : {0, 4}) {
+            auto start_setup = std::chrono::high_resolution_clock::now();
+            algebra::AdditiveSchwarz<double> ras(L_grid, domains, overlap, algebra::LocalSolver::Direct);
+            auto end_setup = std::chrono::high_resolution_clock::now();
+            std::cout<<"Set up in "<<std::chrono::duration_cast<std::chrono::microseconds>(end_setup - start_setup).count()
+                     <<" us, first subdomain with "<<ras.subdomain_size(0)<<" rows. ";
+            run_gmres("with RAS, " + std::to_string(domains) + " subdomains, overlap " + std::to_string(overlap) + ", direct", ras);
+        }
+    }
+
+
+
+    /// ####################    SCALING AND PRUNING   ################################
+
+    std::cout<<"\n\n\n\n####  TEST WITH SCALING AND PRUNING   ####"<<std::endl;
+
+    // Badly scaled copy of L_grid (the copy shares the values of L_grid until scale_rows makes it private)
+    const std::size_t grid_size = n_grid*n_grid;
+    auto badly_scaled = L_grid;
+    std::vector<double> row_factors(grid_size), grid_ones(grid_size, 1.0);
+    for (std::size_t i = 0; i < grid_size; ++i) {
+        row_factors[i] = std::pow(10.0, static_cast<double>(i % 7) - 3);
+    }
+    badly_scaled.scale_rows(row_factors);
+    std::vector<double> scaled_b = badly_scaled * grid_ones, scaled_x;
+    auto scaled_result = algebra::gmres(badly_scaled, scaled_b, scaled_x, 1e-8, 3000, 50);
+    std::cout<<"Rows scaled by 1e-3 ... 1e3, infinity norm: "<<badly_scaled.norm<algebra::NormType::Infinity>()
+             <<", L_grid untouched: "<<(L_grid.norm<algebra::NormType::Infinity>() == 8)<<"; GMRES: "<<scaled_result.iterations<<" iterations"<<std::endl;
+
+    auto start_ruiz = std::chrono::high_resolution_clock::now();
+    auto [D_r, D_c] = badly_scaled.equilibrate();
+    auto end_ruiz = std::chrono::high_resolution_clock::now();
+    std::vector<double> equilibrated_b(grid_size), equilibrated_x;
+    for (std::size_t i = 0; i < grid_size; ++i) {
+        equilibrated_b[i] = D_r[i] * scaled_b[i];
+    }
+    auto equilibrated_result = algebra::gmres(badly_scaled, equilibrated_b, equilibrated_x, 1e-8, 3000, 50);
+    for (std::size_t i = 0; i < grid_size; ++i) {
+        equilibrated_x[i] *= D_c[i];
+    }
+    std::cout<<"Ruiz equilibration in "<<std::chrono::duration_cast<std::chrono::microseconds>(end_ruiz - start_ruiz).count()
+             <<" us, infinity norm "<<badly_scaled.norm<algebra::NormType::Infinity>()<<"; GMRES on the equilibrated system: "
+             <<equilibrated_result.iterations<<" iterations, |x - 1| = "<<algebra::norm2(algebra::evaluate(algebra::lazy(equilibrated_x) - grid_ones))<<std::endl;
+
+    // Drop the couplings (|a| = 1) of a copy of L1: in place, and through the map of the uncompressed format
+    auto pruned = L1, pruned_map = L1;
+    auto start_prune = std::chrono::high_resolution_clock::now();
+    std::size_t removed = pruned.prune(1.5);
+    auto end_prune = std::chrono::high_resolution_clock::now();
+    pruned_map.uncompress();
+    algebra::Matrix<double, algebra::StorageOrder::RowOrdering> filtered(N*N, N*N);
+    for (std::size_t i = 0; i < N*N; ++i) {
+        for (std::size_t j = i - std::min<std::size_t>(i, N); j < std::min<std::size_t>(N*N, i + N + 1); ++j) {
+            const double value = std::as_const(pruned_map)(i, j);
+            if (std::abs(value) > 1.5) {
+                filtered(i, j) = value;
+            }
+        }
+    }
+    filtered.compress();
+    auto end_map = std::chrono::high_resolution_clock::now();
+    std::cout<<"prune(1.5) removed "<<removed<<" elements in "<<std::chrono::duration_cast<std::chrono::microseconds>(end_prune - start_prune).count()
+             <<" us (through the map: "<<std::chrono::duration_cast<std::chrono::microseconds>(end_map - end_prune).count()
+             <<" us), "<<pruned.nonzeros()<<" left, same product as the filtered map: "<<(pruned * ones == filtered * ones)
+             <<", L1 keeps "<<L1.nonzeros()<<std::endl;
+
     return 0;
    
 }
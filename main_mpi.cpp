@@ -0,0 +1,132 @@
+#include "distributed_solvers.hpp"
+#include <chrono>
+
+
+// Test of the distributed matrix: run with
+//   mpirun -np 4 ./main_mpi
+
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // ####################    DISTRIBUTED MATRIX-VECTOR PRODUCT   ################################
+
+    if (rank == 0) {
+        std::cout<<"\n#### TEST WITH A DISTRIBUTED MATRIX ON "<<size<<" RANKS ####"<<std::endl;
+    }
+
+    // every rank reads the matrix and keeps its rows
+    algebra::Matrix<double,algebra::StorageOrder::RowOrdering> M(0,0);
+    M.read("lnsp_131.mtx");
+    M.compress();
+    algebra::DistributedMatrix<double> D(MPI_COMM_WORLD, M);
+
+    for (int r = 0; r < size; ++r) {
+        if (r == rank) {
+            std::cout<<"Rank "<<rank<<": rows ["<<D.row_begin()<<", "<<D.row_begin()+D.rows()<<"), "
+                     <<D.local_block().nonzeros()<<" local and "<<D.off_process_block().nonzeros()
+                     <<" off-process non zeros, "<<D.ghosts()<<" ghosts"<<std::endl;
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    // the same vector on every rank: x_i = i
+    std::vector<double> x(M.cols());
+    std::iota(x.begin(), x.end(), 0.0);
+    std::vector<double> x_local(x.begin() + D.col_begin(), x.begin() + D.col_begin() + D.cols());
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<double> y_local = D*x_local;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto delta_t = std::chrono::duration_cast<std::chrono::microseconds>(t1-t0);
+
+    // compare with the serial product
+    std::vector<double> y = M*x;
+    double max_diff{0};
+    for (std::size_t i = 0; i < D.rows(); ++i) {
+        max_diff = std::max(max_diff, std::abs(y[D.row_begin() + i] - y_local[i]));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &max_diff, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::cout<<"\nDistributed M*x, max difference with the serial product: "<<max_diff<<std::endl;
+        std::cout<<"The operation takes : "<<delta_t.count()<<" ms"<<std::endl;
+    }
+
+
+    // ####################    COLLECTIVE READING   ################################
+
+    if (rank == 0) {
+        std::cout<<"\n#### TEST WITH A MATRIX READ IN PARALLEL (MPI-IO) ####"<<std::endl;
+    }
+    auto R = algebra::DistributedMatrix<double>::read(MPI_COMM_WORLD, "lnsp_131.mtx");
+    std::vector<double> z_local = R*x_local;
+    max_diff = 0;
+    for (std::size_t i = 0; i < R.rows(); ++i) {
+        max_diff = std::max(max_diff, std::abs(y[R.row_begin() + i] - z_local[i]));
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &max_diff, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    std::size_t nonzeros = R.local_block().nonzeros() + R.off_process_block().nonzeros();
+    MPI_Allreduce(MPI_IN_PLACE, &nonzeros, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::cout<<"Non zero elements read by all the ranks: "<<nonzeros<<std::endl;
+        std::cout<<"M*x with the matrix read in parallel, max difference with the serial product: "<<max_diff<<std::endl;
+    }
+
+
+    // ####################    DISTRIBUTED SOLVERS   ################################
+
+    if (rank == 0) {
+        std::cout<<"\n#### TEST WITH THE DISTRIBUTED SOLVERS ####"<<std::endl;
+    }
+    // 2D convection-diffusion on a N x N grid (5-point stencil): each rank builds its own rows
+    // c = 0 gives the (symmetric positive definite) Laplacian
+    const std::size_t N = 200;
+    auto stencil = [&](double c){
+        const std::size_t first = algebra::partition_begin(N*N, size, rank);
+        const std::size_t last = algebra::partition_begin(N*N, size, rank + 1);
+        std::vector<std::size_t> row_ptr{0}, columns;
+        std::vector<double> values;
+        for (std::size_t k = first; k < last; ++k) {
+            const std::size_t i = k / N, j = k % N;
+            auto add = [&](std::size_t col, double v){ columns.push_back(col); values.push_back(v); };
+            if (i > 0) add(k - N, -1.0);
+            if (j > 0) add(k - 1, -1.0 - c);
+            add(k, 4.0);
+            if (j + 1 < N) add(k + 1, -1.0 + c);
+            if (i + 1 < N) add(k + N, -1.0);
+            row_ptr.push_back(columns.size());
+        }
+        return algebra::DistributedMatrix<double>(MPI_COMM_WORLD, N*N, N*N, std::move(row_ptr), std::move(columns), std::move(values));
+    };
+
+    auto L = stencil(0.0);
+    std::vector<double> b(L.rows(), 1.0), u(L.rows(), 0.0);
+    auto cg_result = algebra::cg(L, b, u, 1e-8, 5000);
+    if (rank == 0) {
+        std::cout<<"Pipelined CG on the Laplacian ("<<N*N<<" unknowns): "<<cg_result.iterations<<" iterations, residual "
+                 <<cg_result.residual<<"\n  "<<cg_result.timing<<std::endl;
+    }
+
+    auto C = stencil(0.3);
+    std::fill(u.begin(), u.end(), 0.0);
+    auto gmres_result = algebra::gmres(C, b, u, 1e-8, 5000, 50);
+    // check the true residual
+    std::vector<double> Cu = C*u;
+    double res{0}, nb{0};
+    for (std::size_t i = 0; i < Cu.size(); ++i) {
+        res += (b[i] - Cu[i]) * (b[i] - Cu[i]);
+        nb += b[i] * b[i];
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &res, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &nb, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::cout<<"GMRES(50) on the convection-diffusion operator: "<<gmres_result.iterations<<" iterations, residual "
+                 <<gmres_result.residual<<" (true residual "<<std::sqrt(res/nb)<<")\n  "<<gmres_result.timing<<std::endl;
+    }
+
+    MPI_Finalize();
+    return 0;
+}
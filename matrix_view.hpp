@@ -0,0 +1,356 @@
+/**
+ * @file matrix_view.hpp
+ * @brief Contains the definition of MatrixView, a read-only non-owning view of a compressed matrix.
+ *
+ * A MatrixView supports all the read-only operations of a compressed Matrix: const element access,
+ * matrix-vector product (and SpMM), norms, and can be passed to the solvers of iterative_solvers.hpp.
+ * It can be built from a Matrix or from CSR/CSC arrays owned by another component, given as std::span.
+ * row_range and col_range give zero-copy views of contiguous rows (columns) of a compressed matrix, and
+ * submatrix extracts the block A[rows, cols] for arbitrary index sets.
+ */
+
+#ifndef MATRIX_VIEW_HPP
+#define MATRIX_VIEW_HPP
+
+#include "sparse_matrix.hpp"
+#include <limits>
+#include <thread>
+
+namespace algebra {
+
+    /**
+     * @brief Read-only view of a matrix in compressed format (CSR or CSC) whose arrays are owned by someone else
+     * (a Matrix, a shared memory segment, ...). The view never copies the arrays: the owner must outlive it.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    class MatrixView {
+    private:
+        std::size_t numrows;  /*!< number of rows of the matrix*/
+        std::size_t numcols; /*!< number of columns of the matrix*/
+
+        std::span<const std::size_t> compressed_inner; //!< inner index, entries are positions in outer and data
+        std::span<const std::size_t> compressed_outer; //!< outer index
+        std::span<const T> compressed_data; //!< values of the non zero elements
+
+    public:
+        /**
+         * @brief Constructor: constructs a view over existing compressed arrays
+         *
+         * @param rows Number of rows in the matrix
+         * @param cols Number of columns in the matrix
+         * @param inner Inner index (rows+1 entries for RowOrdering, cols+1 for ColumnOrdering)
+         * @param outer Outer index
+         * @param data Values of the non zero elements
+         */
+        MatrixView(std::size_t rows, std::size_t cols, std::span<const std::size_t> inner,
+                   std::span<const std::size_t> outer, std::span<const T> data)
+            : numrows(rows), numcols(cols), compressed_inner(inner), compressed_outer(outer), compressed_data(data){
+            const std::size_t sz = (Order == StorageOrder::RowOrdering) ? rows : cols;
+            if (inner.size() != sz + 1) {
+                throw std::invalid_argument("MatrixView: inner index has the wrong size.");
+            }
+            if (outer.size() != data.size() || inner.back() > outer.size() || inner.front() > inner.back()) {
+                throw std::invalid_argument("MatrixView: outer index and data are not consistent with the inner index.");
+            }
+        };
+
+        /**
+         * @brief Constructor: constructs a view over a Matrix in compressed format
+         *
+         * @param matrix Compressed matrix, it must outlive the view
+         */
+        MatrixView(const Matrix<T, Order>& matrix)
+            : MatrixView(matrix.rows(), matrix.cols(), checked_inner(matrix), matrix.outer_index(), matrix.values()){};
+
+        /**
+         * @brief Provides const access to matrix elements; returns 0 if the element is inside matrix bounds but is not present
+         *
+         * @param i Row index
+         * @param j Column index
+         * @return const T& Const reference to the element at (i, j)
+         */
+        const T& operator()(std::size_t i, std::size_t j) const{
+            if (i >= numrows || j >= numcols) {
+                throw std::out_of_range("Index out of boundary");
+            }
+            const std::size_t idx = (Order == StorageOrder::RowOrdering) ? i : j;
+            const std::size_t other = (Order == StorageOrder::RowOrdering) ? j : i;
+            auto start = compressed_outer.begin() + compressed_inner[idx];
+            auto end = compressed_outer.begin() + compressed_inner[idx + 1];
+            auto it = std::find(start, end, other);
+            if (it != end) {
+                return compressed_data[std::distance(compressed_outer.begin(), it)];
+            }
+            static T default_value{};
+            return default_value;
+        }
+
+        /**
+         * @brief Computes the norm of the matrix
+         *
+         * @tparam N Type of norm to compute (One, Infinity, Frobenius)
+         * @return T The norm value
+         */
+        template<NormType N>
+        T norm() const{
+            return compressed_norm<N, T, Order>(compressed_inner, compressed_outer, compressed_data, numrows, numcols);
+        }
+
+        /**
+         * @brief Matrix-vector product into an existing vector, y = A x (the LinearOperator interface)
+         *
+         * @param x Vector of cols() entries
+         * @param y Vector of rows() entries, overwritten with the product
+         */
+        void apply(std::span<const T> x, std::span<T> y) const{
+            if (x.size() != numcols || y.size() != numrows) {
+                throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+            }
+            std::fill(y.begin(), y.end(), T{0});
+            compressed_multiply<T, Order>(compressed_inner, compressed_outer, compressed_data, x, y);
+        }
+
+        /**
+         * @brief Utility: a view is always in compressed format
+         */
+        bool is_compressed() const{ return true;};
+
+        /**
+         * @brief Utility: returns the number of rows of the matrix
+         */
+        std::size_t rows() const{ return numrows;};
+
+        /**
+         * @brief Utility: returns the number of columns of the matrix
+         */
+        std::size_t cols() const{ return numcols;};
+
+        /**
+         * @brief Utility: returns the number of non zero elements seen by the view
+         */
+        std::size_t nonzeros() const{ return compressed_inner.back() - compressed_inner.front();};
+
+        /**
+         * @brief Utility: read-only access to the inner index
+         */
+        std::span<const std::size_t> inner_index() const{ return compressed_inner;};
+
+        /**
+         * @brief Utility: read-only access to the outer index
+         */
+        std::span<const std::size_t> outer_index() const{ return compressed_outer;};
+
+        /**
+         * @brief Utility: read-only access to the values
+         */
+        std::span<const T> values() const{ return compressed_data;};
+
+    private:
+        // Checks that the matrix is compressed before taking a view of it
+        static std::span<const std::size_t> checked_inner(const Matrix<T, Order>& matrix){
+            if (!matrix.is_compressed()) {
+                throw std::invalid_argument("MatrixView: the matrix must be in compressed format.");
+            }
+            return matrix.inner_index();
+        }
+    };
+
+
+    /**
+     * @brief Matrix-vector multiplication with a view
+     *
+     * @param view MatrixView object
+     * @param vec Vector to multiply with
+     * @return std::vector<T> Resulting vector
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    std::vector<T> operator*(const MatrixView<T, Order>& view, const std::vector<T>& vec){
+        std::vector<T> result(view.rows());
+        view.apply(vec, result);
+        return result;
+    }
+
+
+    /**
+     * @brief Product between a view and a block of nvec vectors stored by rows (SpMM)
+     *
+     * @param view MatrixView object
+     * @param X Block of vectors, entry v of row j is X[j*nvec + v]
+     * @param nvec Number of vectors in the block
+     * @return std::vector<T> Resulting block (rows x nvec), stored by rows
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    std::vector<T> spmm(const MatrixView<T, Order>& view, std::span<const T> X, std::size_t nvec){
+        if (X.size() != view.cols() * nvec) {
+            throw std::invalid_argument("spmm: the block of vectors has the wrong size.");
+        }
+        std::vector<T> Y(view.rows() * nvec, T{0});
+        compressed_multiply_block<T, Order>(view.inner_index(), view.outer_index(), view.values(), X, nvec, Y);
+        return Y;
+    }
+
+
+    /**
+     * @brief Zero-copy view of the contiguous rows [first, last) of a matrix stored by rows: the view shares
+     * the outer index and the values of the matrix, only the inner index is a sub-range
+     *
+     * @param view The matrix (a compressed Matrix converts to a view)
+     * @param first First row of the range
+     * @param last Row after the end of the range
+     */
+    template<RealOrComplex T>
+    MatrixView<T, StorageOrder::RowOrdering> row_range(const MatrixView<T, StorageOrder::RowOrdering>& view,
+                                                       std::size_t first, std::size_t last){
+        if (first > last || last > view.rows()) {
+            throw std::out_of_range("Row range out of boundary");
+        }
+        return MatrixView<T, StorageOrder::RowOrdering>(last - first, view.cols(), view.inner_index().subspan(first, last - first + 1),
+                                                        view.outer_index(), view.values());
+    }
+
+    template<RealOrComplex T>
+    MatrixView<T, StorageOrder::RowOrdering> row_range(const Matrix<T, StorageOrder::RowOrdering>& matrix,
+                                                       std::size_t first, std::size_t last){
+        return row_range(MatrixView<T, StorageOrder::RowOrdering>(matrix), first, last);
+    }
+
+    /**
+     * @brief Zero-copy view of the contiguous columns [first, last) of a matrix stored by columns
+     *
+     * @param view The matrix (a compressed Matrix converts to a view)
+     * @param first First column of the range
+     * @param last Column after the end of the range
+     */
+    template<RealOrComplex T>
+    MatrixView<T, StorageOrder::ColumnOrdering> col_range(const MatrixView<T, StorageOrder::ColumnOrdering>& view,
+                                                          std::size_t first, std::size_t last){
+        if (first > last || last > view.cols()) {
+            throw std::out_of_range("Column range out of boundary");
+        }
+        return MatrixView<T, StorageOrder::ColumnOrdering>(view.rows(), last - first, view.inner_index().subspan(first, last - first + 1),
+                                                           view.outer_index(), view.values());
+    }
+
+    template<RealOrComplex T>
+    MatrixView<T, StorageOrder::ColumnOrdering> col_range(const Matrix<T, StorageOrder::ColumnOrdering>& matrix,
+                                                          std::size_t first, std::size_t last){
+        return col_range(MatrixView<T, StorageOrder::ColumnOrdering>(matrix), first, last);
+    }
+
+
+    /**
+     * @brief Extracts the submatrix A[rows, cols] in compressed format: element (i, j) of the result is
+     * A(rows[i], cols[j]). The indices may be in any order; the indices of the inner dimension (rows for
+     * RowOrdering, columns for ColumnOrdering) may be repeated, the indices of the outer dimension (columns for
+     * RowOrdering, rows for ColumnOrdering) may not.
+     *
+     * The indices of the other dimension are translated with a map (original index -> position in the
+     * index set), then two passes run over the selected rows (columns for ColumnOrdering), split among threads:
+     * the first counts the entries kept, the second copies them at the positions given by the prefix sum.
+     *
+     * @param view The matrix (a compressed Matrix converts to a view)
+     * @param rows Rows of the submatrix
+     * @param cols Columns of the submatrix
+     * @param threads Number of threads
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    Matrix<T, Order> submatrix(const MatrixView<T, Order>& view, std::span<const std::size_t> rows, std::span<const std::size_t> cols,
+                               std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1)){
+        constexpr bool by_rows = Order == StorageOrder::RowOrdering;
+        // selected: indices along the inner index, mapped: indices along the outer index
+        std::span<const std::size_t> selected = by_rows ? rows : cols;
+        std::span<const std::size_t> mapped = by_rows ? cols : rows;
+        const std::size_t extent = by_rows ? view.cols() : view.rows();
+        const std::size_t sz = by_rows ? view.rows() : view.cols();
+
+        constexpr std::size_t absent = std::numeric_limits<std::size_t>::max();
+        std::vector<std::size_t> position(extent, absent);
+        bool sorted = true;
+        for (std::size_t m = 0; m < mapped.size(); ++m) {
+            if (mapped[m] >= extent) {
+                throw std::out_of_range("Index out of boundary");
+            }
+            if (position[mapped[m]] != absent) {
+                throw std::invalid_argument("Repeated index in the submatrix.");
+            }
+            position[mapped[m]] = m;
+            sorted = sorted && (m == 0 || mapped[m] > mapped[m - 1]);
+        }
+        for (std::size_t idx : selected) {
+            if (idx >= sz) {
+                throw std::out_of_range("Index out of boundary");
+            }
+        }
+
+        auto inner = view.inner_index();
+        auto outer = view.outer_index();
+        auto data = view.values();
+        std::pmr::vector<std::size_t> new_inner(selected.size() + 1, 0);
+        std::pmr::vector<std::size_t> new_outer;
+        std::pmr::vector<T> new_data;
+        auto parallel = [&](auto&& pass){
+            const std::size_t nthreads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(selected.size() / 1024, 1));
+            std::vector<std::thread> workers;
+            for (std::size_t t = 1; t < nthreads; ++t) {
+                workers.emplace_back(pass, selected.size() * t / nthreads, selected.size() * (t + 1) / nthreads);
+            }
+            pass(0, selected.size() / nthreads);
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        };
+
+        // First pass: number of entries of each row kept
+        parallel([&](std::size_t first, std::size_t last){
+            for (std::size_t s = first; s < last; ++s) {
+                std::size_t count = 0;
+                for (std::size_t k = inner[selected[s]]; k < inner[selected[s] + 1]; ++k) {
+                    count += position[outer[k]] != absent;
+                }
+                new_inner[s + 1] = count;
+            }
+        });
+        std::inclusive_scan(new_inner.begin(), new_inner.end(), new_inner.begin());
+        new_outer.resize(new_inner.back());
+        new_data.resize(new_inner.back());
+
+        // Second pass: copy of the entries, sorted within each row if the index set is not increasing
+        parallel([&](std::size_t first, std::size_t last){
+            std::vector<std::pair<std::size_t, T>> row;
+            for (std::size_t s = first; s < last; ++s) {
+                std::size_t pos = new_inner[s];
+                for (std::size_t k = inner[selected[s]]; k < inner[selected[s] + 1]; ++k) {
+                    if (position[outer[k]] != absent) {
+                        new_outer[pos] = position[outer[k]];
+                        new_data[pos] = data[k];
+                        ++pos;
+                    }
+                }
+                if (!sorted) {
+                    row.clear();
+                    for (std::size_t k = new_inner[s]; k < pos; ++k) {
+                        row.emplace_back(new_outer[k], new_data[k]);
+                    }
+                    std::sort(row.begin(), row.end(), [](const auto& a, const auto& b){ return a.first < b.first;});
+                    for (std::size_t k = new_inner[s]; k < pos; ++k) {
+                        new_outer[k] = row[k - new_inner[s]].first;
+                        new_data[k] = row[k - new_inner[s]].second;
+                    }
+                }
+            }
+        });
+        return Matrix<T, Order>(rows.size(), cols.size(), std::move(new_inner), std::move(new_outer), std::move(new_data));
+    }
+
+    template<RealOrComplex T, StorageOrder Order >
+    Matrix<T, Order> submatrix(const Matrix<T, Order>& matrix, std::span<const std::size_t> rows, std::span<const std::size_t> cols,
+                               std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1)){
+        return submatrix(MatrixView<T, Order>(matrix), rows, cols, threads);
+    }
+
+} // namespace algebra
+
+#endif // MATRIX_VIEW_HPP
@@ -0,0 +1,168 @@
+/**
+ * @file memory_resources.hpp
+ * @brief Contains memory resources (std::pmr) used for the storage of the Matrix class.
+ */
+
+#ifndef MEMORY_RESOURCES_HPP
+#define MEMORY_RESOURCES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+
+namespace algebra {
+
+    /**
+     * @brief Monotonic arena for the assembly of a Matrix in uncompressed format.
+     *
+     * Every node of the map is allocated by bumping a pointer in large blocks, deallocation is a no-op.
+     * When a matrix whose map uses an AssemblyArena is compressed, the map is dropped without visiting
+     * its nodes and the whole arena is released at once.
+     * An arena must be used by one matrix at a time and must outlive it.
+     */
+    class AssemblyArena : public std::pmr::memory_resource {
+    public:
+        /**
+         * @brief Constructor
+         *
+         * @param initial_size Size in bytes of the first block (e.g. expected non zeros times 64)
+         * @param upstream Resource providing the blocks
+         */
+        explicit AssemblyArena(std::size_t initial_size = 1 << 16,
+                               std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : arena(initial_size > 0 ? initial_size : 1, upstream){};
+
+        AssemblyArena(const AssemblyArena&) = delete;
+        AssemblyArena& operator=(const AssemblyArena&) = delete;
+
+        /**
+         * @brief Gives all the blocks back to the upstream resource: every allocation becomes invalid
+         */
+        void release(){
+            arena.release();
+            allocated = 0;
+        }
+
+        /**
+         * @brief Number of bytes handed out since the last release
+         */
+        std::size_t bytes_allocated() const{ return allocated;};
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override{
+            allocated += bytes;
+            return arena.allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void*, std::size_t, std::size_t) override{
+            // Memory is given back only by release()
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override{
+            return this == &other;
+        }
+
+        std::pmr::monotonic_buffer_resource arena; //!< the underlying bump allocator
+        std::size_t allocated = 0; //!< bytes handed out since the last release
+    };
+
+
+    /**
+     * @brief How HugePageResource asks the kernel for huge pages
+     */
+    enum class HugePages {
+        None,        //!< regular pages, only the alignment is enforced
+        Transparent, //!< anonymous mapping with madvise(MADV_HUGEPAGE) (transparent huge pages)
+        Explicit     //!< MAP_HUGETLB mapping from the hugetlbfs pool, falls back to Transparent if the pool is empty
+    };
+
+    /**
+     * @brief Memory resource for the large arrays of the compressed format.
+     *
+     * Every allocation is aligned to at least a cache line (64 bytes), so that SIMD kernels can use aligned loads.
+     * Allocations of at least threshold bytes are served by their own anonymous mapping, aligned to 2 MB and
+     * backed by huge pages according to the policy: SpMV over multi-GB arrays then needs 512 times fewer TLB entries.
+     * Use it as storage resource of a Matrix, e.g. Matrix<double, StorageOrder::RowOrdering> A(n, n, 
+     * std::pmr::get_default_resource(), &algebra::huge_page_resource()).
+     */
+    class HugePageResource : public std::pmr::memory_resource {
+    public:
+        static constexpr std::size_t cache_line = 64; //!< minimum alignment of the allocations
+        static constexpr std::size_t huge_page = std::size_t{2} << 20; //!< size of a huge page (x86-64, aarch64)
+
+        /**
+         * @brief Constructor
+         *
+         * @param policy How to obtain the huge pages
+         * @param threshold Allocations smaller than this use aligned operator new
+         */
+        explicit HugePageResource(HugePages policy = HugePages::Transparent, std::size_t threshold = huge_page)
+            : policy(policy), threshold(threshold){};
+
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override{
+            alignment = std::max(alignment, cache_line);
+            if (bytes < threshold || policy == HugePages::None) {
+                return ::operator new(bytes, std::align_val_t{alignment});
+            }
+            const std::size_t length = round_up(bytes);
+            if (policy == HugePages::Explicit) {
+                void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (ptr != MAP_FAILED) {
+                    return ptr;
+                }
+            }
+            // Map one more huge page and trim the ends, so that the block starts on a huge page boundary
+            char* raw = static_cast<char*>(mmap(nullptr, length + huge_page, PROT_READ | PROT_WRITE,
+                                                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (raw == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+            const std::size_t misalignment = reinterpret_cast<std::uintptr_t>(raw) % huge_page;
+            const std::size_t head = misalignment == 0 ? 0 : huge_page - misalignment;
+            if (head > 0) {
+                munmap(raw, head);
+            }
+            if (huge_page - head > 0) {
+                munmap(raw + head + length, huge_page - head);
+            }
+            madvise(raw + head, length, MADV_HUGEPAGE);
+            return raw + head;
+        }
+
+        void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment) override{
+            alignment = std::max(alignment, cache_line);
+            if (bytes < threshold || policy == HugePages::None) {
+                ::operator delete(ptr, bytes, std::align_val_t{alignment});
+            } else {
+                munmap(ptr, round_up(bytes));
+            }
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override{
+            return this == &other;
+        }
+
+        // Rounds a size up to a multiple of the huge page size
+        static std::size_t round_up(std::size_t bytes){
+            return (bytes + huge_page - 1) / huge_page * huge_page;
+        }
+
+        HugePages policy; //!< how huge pages are requested
+        std::size_t threshold; //!< minimum size served by a dedicated mapping
+    };
+
+    /**
+     * @brief Process-wide HugePageResource with transparent huge pages
+     */
+    inline HugePageResource& huge_page_resource(){
+        static HugePageResource resource(HugePages::Transparent);
+        return resource;
+    }
+
+} // namespace algebra
+
+#endif // MEMORY_RESOURCES_HPP
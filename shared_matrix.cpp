@@ -0,0 +1,260 @@
+/**
+ * @file shared_matrix.cpp
+ * @brief Contains the implementation of the SharedMatrix member functions
+ */
+
+#include "shared_matrix.hpp"
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace algebra {
+
+    namespace {
+        constexpr std::uint64_t shared_magic = 0x5041435353484d31; // "PACSSHM1"
+
+        // Rounds offset up to a multiple of 64 bytes (cache line)
+        std::size_t align_up(std::size_t offset){
+            return (offset + 63) & ~std::size_t{63};
+        }
+
+        // Checks that count elements of size bytes starting at offset lie within a mapping of length bytes,
+        // without overflowing
+        bool in_segment(std::uint64_t offset, std::uint64_t count, std::size_t size, std::size_t length){
+            return offset <= length && count <= (length - offset) / size;
+        }
+
+        // Builds the message of an exception from the last system error
+        std::string system_message(const std::string& what, const std::string& name){
+            return what + " " + name + ": " + std::strerror(errno);
+        }
+    }
+
+
+
+    // Publishes a compressed matrix in a new shared memory segment
+    template<RealOrComplex T, StorageOrder Order>
+    SharedMatrix<T, Order> SharedMatrix<T, Order>::publish(const Matrix<T, Order>& matrix, const std::string& name){
+        if (!matrix.is_compressed()) {
+            throw std::invalid_argument("Only a matrix in compressed form can be published.");
+        }
+        auto inner = matrix.inner_index();
+        auto outer = matrix.outer_index();
+        auto data = matrix.values();
+
+        // Layout: header in the first page, then the three arrays aligned to cache lines
+        const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        const std::size_t inner_offset = page;
+        const std::size_t outer_offset = align_up(inner_offset + inner.size_bytes());
+        const std::size_t data_offset = align_up(outer_offset + outer.size_bytes());
+        const std::size_t length = data_offset + data.size_bytes();
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            throw std::runtime_error(system_message("Cannot create shared memory segment", name));
+        }
+        if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+            std::string msg = system_message("Cannot size shared memory segment", name);
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error(msg);
+        }
+        void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            std::string msg = system_message("Cannot map shared memory segment", name);
+            shm_unlink(name.c_str());
+            throw std::runtime_error(msg);
+        }
+
+        // Copy the arrays, then fill the header
+        char* bytes = static_cast<char*>(base);
+        std::memcpy(bytes + inner_offset, inner.data(), inner.size_bytes());
+        std::memcpy(bytes + outer_offset, outer.data(), outer.size_bytes());
+        std::memcpy(bytes + data_offset, data.data(), data.size_bytes());
+
+        Header* h = new (base) Header{};
+        h->value_size = sizeof(T);
+        h->ordering = static_cast<std::uint32_t>(Order);
+        h->refcount.store(1, std::memory_order_relaxed);
+        h->numrows = matrix.rows();
+        h->numcols = matrix.cols();
+        h->inner_size = inner.size();
+        h->nnz = data.size();
+        h->inner_offset = inner_offset;
+        h->outer_offset = outer_offset;
+        h->data_offset = data_offset;
+        // The magic number is written last: attachers never see a partially written segment
+        std::atomic_ref<std::uint64_t>(h->magic).store(shared_magic, std::memory_order_release);
+
+        if (length > page) {
+            mprotect(bytes + page, length - page, PROT_READ);
+        }
+        return SharedMatrix(name, base, length);
+    }
+
+
+
+    // Attaches to a matrix published by another process
+    template<RealOrComplex T, StorageOrder Order>
+    SharedMatrix<T, Order> SharedMatrix<T, Order>::attach(const std::string& name){
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            throw std::runtime_error(system_message("Cannot open shared memory segment", name));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("Shared memory segment " + name + " is not a published matrix.");
+        }
+        const std::size_t length = static_cast<std::size_t>(st.st_size);
+        void* base = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            throw std::runtime_error(system_message("Cannot map shared memory segment", name));
+        }
+
+        Header* h = static_cast<Header*>(base);
+        auto fail = [&](const std::string& msg){
+            munmap(base, length);
+            throw std::runtime_error("Shared memory segment " + name + ": " + msg);
+        };
+        if (std::atomic_ref<std::uint64_t>(h->magic).load(std::memory_order_acquire) != shared_magic) {
+            fail("not a published matrix (or publication not completed).");
+        }
+        if (h->value_size != sizeof(T) || h->ordering != static_cast<std::uint32_t>(Order)) {
+            fail("element type or storage order do not match.");
+        }
+        // The header may be corrupted: every array must lie within the mapping, be aligned, and have the right size
+        const std::uint64_t inner_expected = (Order == StorageOrder::RowOrdering ? h->numrows : h->numcols) + 1;
+        if (h->inner_size == 0 || h->inner_size != inner_expected) {
+            fail("wrong size of the inner index.");
+        }
+        if (!in_segment(h->inner_offset, h->inner_size, sizeof(std::size_t), length) ||
+            !in_segment(h->outer_offset, h->nnz, sizeof(std::size_t), length) ||
+            !in_segment(h->data_offset, h->nnz, sizeof(T), length)) {
+            fail("segment is truncated.");
+        }
+        if (h->inner_offset % alignof(std::size_t) != 0 || h->outer_offset % alignof(std::size_t) != 0 ||
+            h->data_offset % alignof(T) != 0) {
+            fail("misaligned arrays.");
+        }
+        const auto* inner = reinterpret_cast<const std::size_t*>(static_cast<const char*>(base) + h->inner_offset);
+        if (inner[0] != 0 || inner[h->inner_size - 1] != h->nnz) {
+            fail("inconsistent inner index.");
+        }
+
+        // Take a reference, unless the last handle is already removing the segment
+        std::uint64_t count = h->refcount.load(std::memory_order_relaxed);
+        do {
+            if (count == 0) {
+                fail("segment is being removed.");
+            }
+        } while (!h->refcount.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel));
+
+        const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        if (length > page) {
+            mprotect(static_cast<char*>(base) + page, length - page, PROT_READ);
+        }
+        return SharedMatrix(name, base, length);
+    }
+
+
+
+    // Removes the name of a segment
+    template<RealOrComplex T, StorageOrder Order>
+    void SharedMatrix<T, Order>::remove(const std::string& name){
+        shm_unlink(name.c_str());
+    }
+
+
+
+    // Move constructor and assignment: the moved-from handle holds no reference
+    template<RealOrComplex T, StorageOrder Order>
+    SharedMatrix<T, Order>::SharedMatrix(SharedMatrix&& other) noexcept
+        : segment_name(std::move(other.segment_name)), base(other.base), length(other.length){
+        other.base = nullptr;
+        other.length = 0;
+    }
+
+    template<RealOrComplex T, StorageOrder Order>
+    SharedMatrix<T, Order>& SharedMatrix<T, Order>::operator=(SharedMatrix&& other) noexcept{
+        if (this != &other) {
+            release();
+            segment_name = std::move(other.segment_name);
+            base = other.base;
+            length = other.length;
+            other.base = nullptr;
+            other.length = 0;
+        }
+        return *this;
+    }
+
+    template<RealOrComplex T, StorageOrder Order>
+    SharedMatrix<T, Order>::~SharedMatrix(){
+        release();
+    }
+
+
+
+    // Drops the reference held by the handle, the last one unlinks the segment
+    template<RealOrComplex T, StorageOrder Order>
+    void SharedMatrix<T, Order>::release(){
+        if (base == nullptr) {
+            return;
+        }
+        if (header()->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            shm_unlink(segment_name.c_str());
+        }
+        munmap(base, length);
+        base = nullptr;
+        length = 0;
+    }
+
+
+
+    // Read-only view of the shared arrays
+    template<RealOrComplex T, StorageOrder Order>
+    MatrixView<T, Order> SharedMatrix<T, Order>::view() const{
+        if (base == nullptr) {
+            throw std::logic_error("SharedMatrix handle is empty.");
+        }
+        const Header* h = header();
+        const char* bytes = static_cast<const char*>(base);
+        return MatrixView<T, Order>(h->numrows, h->numcols,
+            {reinterpret_cast<const std::size_t*>(bytes + h->inner_offset), h->inner_size},
+            {reinterpret_cast<const std::size_t*>(bytes + h->outer_offset), h->nnz},
+            {reinterpret_cast<const T*>(bytes + h->data_offset), h->nnz});
+    }
+
+
+
+    // Number of live handles
+    template<RealOrComplex T, StorageOrder Order>
+    std::uint64_t SharedMatrix<T, Order>::references() const{
+        return base == nullptr ? 0 : header()->refcount.load(std::memory_order_relaxed);
+    }
+
+
+
+    // Explicit instantiation for the element types of Matrix (see sparse_matrix.cpp)
+    template class SharedMatrix<double, StorageOrder::RowOrdering>;
+    template class SharedMatrix<double, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<std::complex<double>, StorageOrder::RowOrdering>;
+    template class SharedMatrix<std::complex<double>, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<float, StorageOrder::RowOrdering>;
+    template class SharedMatrix<float, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<std::complex<float>, StorageOrder::RowOrdering>;
+    template class SharedMatrix<std::complex<float>, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<long double, StorageOrder::RowOrdering>;
+    template class SharedMatrix<long double, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<int, StorageOrder::RowOrdering>;
+    template class SharedMatrix<int, StorageOrder::ColumnOrdering>;
+    template class SharedMatrix<long, StorageOrder::RowOrdering>;
+    template class SharedMatrix<long, StorageOrder::ColumnOrdering>;
+
+} // namespace algebra
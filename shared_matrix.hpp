@@ -0,0 +1,112 @@
+/**
+ * @file shared_matrix.hpp
+ * @brief Contains the definition of SharedMatrix, a compressed matrix published in POSIX shared memory.
+ */
+
+#ifndef SHARED_MATRIX_HPP
+#define SHARED_MATRIX_HPP
+
+#include "matrix_view.hpp"
+#include <atomic>
+#include <cstdint>
+
+namespace algebra {
+
+    /**
+     * @brief Handle to a compressed matrix stored in a POSIX shared memory segment (shm_open + mmap).
+     *
+     * One process publishes a compressed Matrix under a name, any other process on the node attaches to it
+     * and gets a zero-copy, read-only MatrixView: all of them run SpMV against one physical copy.
+     * The segment is reference counted: every handle holds one reference and the segment name is
+     * unlinked when the last handle is destroyed. If a process dies without destroying its handles
+     * the segment survives and can be removed with SharedMatrix::remove.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    class SharedMatrix {
+    public:
+        /**
+         * @brief Publishes a compressed matrix in a new shared memory segment
+         *
+         * @param matrix Matrix in compressed format
+         * @param name Name of the segment (e.g. "/my_operator"), it must not exist yet
+         * @return SharedMatrix Handle holding the first reference to the segment
+         */
+        static SharedMatrix publish(const Matrix<T, Order>& matrix, const std::string& name);
+
+        /**
+         * @brief Attaches to a matrix published by another process
+         *
+         * @param name Name of the segment
+         * @return SharedMatrix Handle holding a new reference to the segment
+         */
+        static SharedMatrix attach(const std::string& name);
+
+        /**
+         * @brief Forcibly removes the name of a segment (e.g. left over by a crashed process)
+         *
+         * @param name Name of the segment
+         */
+        static void remove(const std::string& name);
+
+        SharedMatrix(const SharedMatrix&) = delete;
+        SharedMatrix& operator=(const SharedMatrix&) = delete;
+        SharedMatrix(SharedMatrix&& other) noexcept;
+        SharedMatrix& operator=(SharedMatrix&& other) noexcept;
+
+        /**
+         * @brief Destructor: drops the reference, the last handle unlinks the segment
+         */
+        ~SharedMatrix();
+
+        /**
+         * @brief Returns a read-only view of the shared matrix, valid while the handle is alive
+         */
+        MatrixView<T, Order> view() const;
+
+        /**
+         * @brief Returns the name of the segment
+         */
+        const std::string& name() const{ return segment_name;};
+
+        /**
+         * @brief Returns the number of handles currently attached to the segment (in all processes)
+         */
+        std::uint64_t references() const;
+
+    private:
+        /**
+         * @brief Layout of the first page of the segment
+         */
+        struct Header {
+            std::uint64_t magic; //!< identifies a complete segment, written last by the publisher
+            std::uint32_t value_size; //!< sizeof(T) of the publisher
+            std::uint32_t ordering; //!< storage order of the publisher
+            std::atomic<std::uint64_t> refcount; //!< number of live handles
+            std::uint64_t numrows; //!< number of rows of the matrix
+            std::uint64_t numcols; //!< number of columns of the matrix
+            std::uint64_t inner_size; //!< number of entries of the inner index
+            std::uint64_t nnz; //!< number of non zero elements
+            std::uint64_t inner_offset; //!< offset in bytes of the inner index
+            std::uint64_t outer_offset; //!< offset in bytes of the outer index
+            std::uint64_t data_offset; //!< offset in bytes of the values
+        };
+
+        SharedMatrix(std::string name, void* base, std::size_t length)
+            : segment_name(std::move(name)), base(base), length(length){};
+
+        Header* header() const{ return static_cast<Header*>(base);};
+
+        // Releases the reference and the mapping
+        void release();
+
+        std::string segment_name; //!< name of the segment
+        void* base = nullptr; //!< address of the mapping
+        std::size_t length = 0; //!< length of the mapping
+    };
+
+} // namespace algebra
+
+#endif // SHARED_MATRIX_HPP
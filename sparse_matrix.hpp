@@ -7,6 +7,7 @@
 #define SPARSE_MATRIX_HPP
 
 #include "sparse_matrix_traits.hpp"
+#include "memory_resources.hpp"
 #include <iostream>
 #include <iomanip> 
 #include <map>
@@ -19,10 +20,16 @@
 #include<stdexcept>
 #include<numeric>
 #include<cmath>
+#include <cctype>
 #include <fstream>
 #include <sstream>
 #include <random>
 #include<complex>
+#include <span>
+#include <memory_resource>
+#include <memory>
+#include <cstdint>
+#include <thread>
 
 namespace algebra {
 
@@ -42,6 +49,75 @@ namespace algebra {
     */
     enum class NormType{One, Infinity, Frobenius};
 
+
+    /**
+     * @brief Enumerator indicating how the values of a compressed matrix are stored
+     * @param Plain one value of type T per non zero element
+     * @param Automatic chosen by compress() from the values: Pattern, Dictionary8, Dictionary16 or Plain
+     * @param Dictionary8 8 bit code per non zero element, into a table of at most 256 distinct values
+     * @param Dictionary16 16 bit code per non zero element, into a table of at most 65536 distinct values
+     * @param Pattern no values: every non zero element is equal to 1
+     */
+    enum class ValueEncoding{Plain, Automatic, Dictionary8, Dictionary16, Pattern};
+
+
+    /**
+     * @brief Enumerator indicating the symmetry field of a Matrix Market file: only the lower triangle of a symmetric,
+     * skew-symmetric or hermitian matrix is stored in the file
+     * @param General every entry is stored
+     * @param Symmetric a_ji = a_ij
+     * @param SkewSymmetric a_ji = -a_ij, no diagonal entries
+     * @param Hermitian a_ji = conj(a_ij)
+     */
+    enum class MatrixMarketSymmetry{General, Symmetric, SkewSymmetric, Hermitian};
+
+    /**
+     * @brief Parses the symmetry field of a Matrix Market banner
+     * ("%%MatrixMarket matrix coordinate <field> <symmetry>"), case insensitive
+     *
+     * @param banner First line of the file
+     * @return MatrixMarketSymmetry General if the field is missing
+     * @throw std::runtime_error if the field is not general, symmetric, skew-symmetric or hermitian
+     */
+    inline MatrixMarketSymmetry matrix_market_symmetry(const std::string& banner){
+        std::istringstream iss(banner);
+        std::string word, symmetry;
+        for (int k = 0; k < 5 && iss >> word; ++k) {
+            symmetry = (k == 4) ? word : "";
+        }
+        std::transform(symmetry.begin(), symmetry.end(), symmetry.begin(), [](unsigned char c){ return std::tolower(c);});
+        if (symmetry.empty() || symmetry == "general") {
+            return MatrixMarketSymmetry::General;
+        } else if (symmetry == "symmetric") {
+            return MatrixMarketSymmetry::Symmetric;
+        } else if (symmetry == "skew-symmetric") {
+            return MatrixMarketSymmetry::SkewSymmetric;
+        } else if (symmetry == "hermitian") {
+            return MatrixMarketSymmetry::Hermitian;
+        }
+        throw std::runtime_error("Unknown symmetry in the Matrix Market banner: " + symmetry);
+    }
+
+    /**
+     * @brief Value of the mirrored entry a_ji of a Matrix Market entry a_ij (i != j)
+     *
+     * @param symmetry Symmetry of the file (not General)
+     * @param value The stored value a_ij
+     * @return T a_ij, -a_ij or conj(a_ij)
+     */
+    template<RealOrComplex T>
+    T matrix_market_mirror(MatrixMarketSymmetry symmetry, const T& value){
+        if (symmetry == MatrixMarketSymmetry::SkewSymmetric) {
+            return -value;
+        }
+        if constexpr (Complex<T>) {
+            if (symmetry == MatrixMarketSymmetry::Hermitian) {
+                return std::conj(value);
+            }
+        }
+        return value;
+    }
+
      
     /**
      * @brief Compares two complex numbers by their magnitudes.
@@ -87,50 +163,584 @@ namespace algebra {
     template<RealOrComplex T, StorageOrder Order >
     std::vector<T> generateRandomVector(const Matrix<T, Order>& matrix);
 
-    // Declaration and definition of operator* (matrix-vector multiplication)
-    template<RealOrComplex T, StorageOrder Order >
-    std::vector<T> operator*(const Matrix<T, Order>& matrix, const std::vector<T>& vec){
-            std::vector<T> result(matrix.numrows, T{0}); // Initialize result vector with zeros
-            if (!matrix.is_compressed()) {
-                 // Uncompressed format
-                std::size_t i{0};
-                std::size_t j{0};
-                
-                // Traverse the matrix and compute dot product
-                for (const auto& [coords, value] : matrix.uncompressed_data) {
-                    i = coords[0];
-                    j = coords[1];
-                    result[i] += value * vec[j];
+    /**
+     * @brief Dot product of the non zero elements first ... last-1 of a row with vec, in the summation order shared
+     * by all the row ordered kernels: element k goes to the partial sum (k - first) % 4, and the four partial sums
+     * are added at the end. The partial sums are independent, so the loop can be vectorized, and the order does
+     * not depend on the compiler: the products of a matrix, of several matrices sharing its pattern
+     * (compressed_multiply_multi) and of a combination equal to it (compressed_multiply_combination) agree bit by bit.
+     *
+     * @tparam T The type of elements in the matrix
+     * @param first First non zero element of the row
+     * @param last Non zero element after the last one of the row
+     * @param outer Outer index (column index of each non zero element)
+     * @param value Callable returning the value of the non zero element k
+     * @param vec Vector to multiply with
+     * @return T The dot product
+     */
+    template<RealOrComplex T, typename Value>
+    T compressed_row_dot(std::size_t first, std::size_t last, std::span<const std::size_t> outer, Value value,
+                         std::span<const T> vec){
+        constexpr std::size_t lanes = 4;
+        std::array<T, lanes> partial{};
+        std::size_t k = first;
+        for (; k + lanes <= last; k += lanes) {
+            #pragma omp simd
+            for (std::size_t l = 0; l < lanes; ++l) {
+                partial[l] += value(k + l) * vec[outer[k + l]];
+            }
+        }
+        for (std::size_t l = 0; k < last; ++k, ++l) {
+            partial[l] += value(k) * vec[outer[k]];
+        }
+        return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+    }
+
+    /**
+     * @brief Generic kernel of the matrix-vector product in compressed format: the value of the non zero
+     * element k is given by value(k), so that the same loops serve plain and encoded values.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param value Callable returning the value of the non zero element k
+     * @param vec Vector to multiply with
+     * @param result Vector where the product is accumulated
+     */
+    template<RealOrComplex T, StorageOrder Order, typename Value>
+    void compressed_multiply_with(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                  Value value, std::span<const T> vec, std::span<T> result){
+        const std::size_t sz = inner.empty() ? 0 : inner.size() - 1;
+        if constexpr(Order == StorageOrder::RowOrdering){
+            // Row ordering (CSR): traverse the matrix and perform classical row-times-vector algorithm
+            for (std::size_t i = 0; i < sz; ++i) {
+                result[i] += compressed_row_dot<T>(inner[i], inner[i + 1], outer, value, vec);
+            }
+        }
+        else{
+            // Column ordering (CSC)
+            for (std::size_t j = 0; j < sz; ++j) {
+                for (std::size_t k = inner[j]; k < inner[j + 1]; ++k) {
+                    result[outer[k]] += value(k) * vec[j]; // Compute linear combination
                 }
-            } else {
-                // Compressed format
+            }
+        }
+    }
+
+    /**
+     * @brief Kernel of the matrix-vector product in compressed format, shared by Matrix and MatrixView.
+     * The entries of inner are positions in outer and data: they do not need to start from 0.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param data Values of the non zero elements
+     * @param vec Vector to multiply with
+     * @param result Vector where the product is accumulated
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    void compressed_multiply(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                             std::span<const T> data, std::span<const T> vec, std::span<T> result){
+        compressed_multiply_with<T, Order>(inner, outer, [data](std::size_t k){ return data[k];}, vec, result);
+    }
+
+    /**
+     * @brief Kernel of the matrix-vector product for dictionary encoded values: the value of the non zero
+     * element k is table[codes[k]]
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     * @tparam Code Unsigned integer type of the codes
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param codes Code of each non zero element
+     * @param table Distinct values of the matrix
+     * @param vec Vector to multiply with
+     * @param result Vector where the product is accumulated
+     */
+    template<RealOrComplex T, StorageOrder Order, typename Code>
+    void compressed_multiply_dictionary(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                        std::span<const Code> codes, std::span<const T> table,
+                                        std::span<const T> vec, std::span<T> result){
+        compressed_multiply_with<T, Order>(inner, outer, [codes, table](std::size_t k){ return table[codes[k]];}, vec, result);
+    }
+
+    /**
+     * @brief Kernel of the matrix-vector product for a pattern matrix (all the stored elements equal to 1)
+     *
+     * @tparam T The type of elements in the vectors
+     * @tparam Order The storage order of the matrix
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param vec Vector to multiply with
+     * @param result Vector where the product is accumulated
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    void compressed_multiply_pattern(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                     std::span<const T> vec, std::span<T> result){
+        compressed_multiply_with<T, Order>(inner, outer, [](std::size_t){ return T{1};}, vec, result);
+    }
+
+    /**
+     * @brief Kernel of the product between a compressed matrix and a block of nvec vectors (SpMM).
+     * The block is stored by rows: entry v of row j is X[j*nvec + v], so every non zero element is read once
+     * and updates nvec results.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param data Values of the non zero elements
+     * @param X Block of vectors to multiply with (cols x nvec)
+     * @param nvec Number of vectors in the block
+     * @param Y Block where the product is accumulated (rows x nvec)
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    void compressed_multiply_block(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                   std::span<const T> data, std::span<const T> X, std::size_t nvec, std::span<T> Y){
+        const std::size_t sz = inner.empty() ? 0 : inner.size() - 1;
+        for (std::size_t idx = 0; idx < sz; ++idx) {
+            for (std::size_t k = inner[idx]; k < inner[idx + 1]; ++k) {
+                const T value = data[k];
                 if constexpr(Order == StorageOrder::RowOrdering){
-                // Row ordering (CSR): traverse the matrix and perform classical row-times-vector algorithm
-                    for (std::size_t i = 0; i < matrix.numrows; ++i) {
-                        std::size_t row_start = matrix.compressed_inner[i];
-                        std::size_t row_end = matrix.compressed_inner[i + 1];    
-
-                        for (std::size_t k = row_start; k < row_end; ++k) {
-                            std::size_t col_index = matrix.compressed_outer[k];
-                            T value = matrix.compressed_data[k];
-                            result[i] += value * vec[col_index]; // Compute dot product
-                        }
+                    const T* x = X.data() + outer[k] * nvec;
+                    T* y = Y.data() + idx * nvec;
+                    #pragma omp simd
+                    for (std::size_t v = 0; v < nvec; ++v) {
+                        y[v] += value * x[v];
                     }
                 }
                 else{
-                    // Column ordering (CSC)
-                    for (std::size_t j = 0; j < matrix.numcols; ++j) {
-                        std::size_t col_start = matrix.compressed_inner[j];
-                        std::size_t col_end = matrix.compressed_inner[j + 1];
-                        
-                        for (std::size_t k = col_start; k < col_end; ++k) {
-                            std::size_t row_index = matrix.compressed_outer[k];
-                            T value = matrix.compressed_data[k];
-                            result[row_index] += value * vec[j]; // Compute linear combination
+                    const T* x = X.data() + idx * nvec;
+                    T* y = Y.data() + outer[k] * nvec;
+                    #pragma omp simd
+                    for (std::size_t v = 0; v < nvec; ++v) {
+                        y[v] += value * x[v];
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Rows of compressed_multiply_multi for a number of matrices M known at compile time: the partial sums
+     * are a local array, which the compiler keeps in registers
+     */
+    template<RealOrComplex T, std::size_t M>
+    void compressed_multiply_multi_rows(const std::size_t* inner, const std::size_t* index, const T* const* values,
+                                        const T* x, T* const* outputs, std::size_t sz){
+        constexpr std::size_t lanes = 4;
+        std::array<const T*, M> v;
+        std::copy_n(values, M, v.begin());
+        for (std::size_t i = 0; i < sz; ++i) {
+            std::array<T, M * lanes> partial{}; // partial sum l of matrix m at m * lanes + l
+            const std::size_t first = inner[i], last = inner[i + 1];
+            std::size_t k = first;
+            for (; k + lanes <= last; k += lanes) {
+                // The entries of x of the block are gathered once, then every matrix updates its partial sums
+                std::array<T, lanes> xk;
+                for (std::size_t l = 0; l < lanes; ++l) {
+                    xk[l] = x[index[k + l]];
+                }
+                for (std::size_t m = 0; m < M; ++m) {
+                    #pragma omp simd
+                    for (std::size_t l = 0; l < lanes; ++l) {
+                        partial[m * lanes + l] += v[m][k + l] * xk[l];
+                    }
+                }
+            }
+            for (std::size_t l = 0; k < last; ++k, ++l) {
+                const T xk = x[index[k]];
+                for (std::size_t m = 0; m < M; ++m) {
+                    partial[m * lanes + l] += v[m][k] * xk;
+                }
+            }
+            for (std::size_t m = 0; m < M; ++m) {
+                const T* p = partial.data() + m * lanes;
+                outputs[m][i] += (p[0] + p[1]) + (p[2] + p[3]);
+            }
+        }
+    }
+
+    /**
+     * @brief Kernel of the products y_m = A_m x of several matrices sharing one sparsity pattern.
+     * A single loop runs over the non zero elements: the index of element k (and, by rows, vec[outer[k]]) is loaded
+     * once and used by the values of every matrix, so the index bandwidth is paid once instead of once per matrix.
+     * By rows, element k of matrix m goes to the partial sum (k - first) % 4 of m, as in compressed_row_dot.
+     *
+     * @tparam T The type of elements in the matrices
+     * @tparam Order The storage order of the matrices
+     * @param inner Inner index of the shared pattern
+     * @param outer Outer index of the shared pattern
+     * @param data Values of each matrix, in the order of the pattern
+     * @param vec Vector to multiply with
+     * @param results Vectors where the products are accumulated (one per matrix)
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    void compressed_multiply_multi(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                   std::span<const std::span<const T>> data, std::span<const T> vec,
+                                   std::span<const std::span<T>> results){
+        const std::size_t sz = inner.empty() ? 0 : inner.size() - 1;
+        const std::size_t nmat = data.size();
+        std::vector<const T*> values(nmat);
+        std::vector<T*> outputs(nmat);
+        for (std::size_t m = 0; m < nmat; ++m) {
+            values[m] = data[m].data();
+            outputs[m] = results[m].data();
+        }
+        const std::size_t* index = outer.data();
+        const T* x = vec.data();
+        if constexpr(Order == StorageOrder::RowOrdering){
+            switch (nmat) {
+                case 1: return compressed_multiply_multi_rows<T, 1>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 2: return compressed_multiply_multi_rows<T, 2>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 3: return compressed_multiply_multi_rows<T, 3>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 4: return compressed_multiply_multi_rows<T, 4>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 5: return compressed_multiply_multi_rows<T, 5>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 6: return compressed_multiply_multi_rows<T, 6>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 7: return compressed_multiply_multi_rows<T, 7>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                case 8: return compressed_multiply_multi_rows<T, 8>(inner.data(), index, values.data(), x, outputs.data(), sz);
+                default: break;
+            }
+            // More matrices: the same loop, with the partial sums in memory
+            constexpr std::size_t lanes = 4;
+            std::vector<T> partial(nmat * lanes); // partial sum l of matrix m at m * lanes + l
+            for (std::size_t i = 0; i < sz; ++i) {
+                std::fill(partial.begin(), partial.end(), T{0});
+                const std::size_t first = inner[i], last = inner[i + 1];
+                std::size_t k = first;
+                for (; k + lanes <= last; k += lanes) {
+                    std::array<T, lanes> xk;
+                    for (std::size_t l = 0; l < lanes; ++l) {
+                        xk[l] = x[index[k + l]];
+                    }
+                    for (std::size_t m = 0; m < nmat; ++m) {
+                        T* p = partial.data() + m * lanes;
+                        const T* a = values[m] + k;
+                        #pragma omp simd
+                        for (std::size_t l = 0; l < lanes; ++l) {
+                            p[l] += a[l] * xk[l];
                         }
-                    }  
+                    }
+                }
+                for (std::size_t l = 0; k < last; ++k, ++l) {
+                    const T xk = x[index[k]];
+                    for (std::size_t m = 0; m < nmat; ++m) {
+                        partial[m * lanes + l] += values[m][k] * xk;
+                    }
+                }
+                for (std::size_t m = 0; m < nmat; ++m) {
+                    const T* p = partial.data() + m * lanes;
+                    outputs[m][i] += (p[0] + p[1]) + (p[2] + p[3]);
+                }
+            }
+        }
+        else{
+            for (std::size_t j = 0; j < sz; ++j) {
+                const T xj = x[j];
+                for (std::size_t k = inner[j]; k < inner[j + 1]; ++k) {
+                    const std::size_t row = index[k];
+                    for (std::size_t m = 0; m < nmat; ++m) {
+                        outputs[m][row] += values[m][k] * xj;
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Kernel of the product y = (sum_m c_m A_m) x of a linear combination of matrices sharing one
+     * sparsity pattern. The combined value of every non zero element is formed on the fly: neither the
+     * combined matrix nor the single products are stored.
+     *
+     * @tparam T The type of elements in the matrices
+     * @tparam Order The storage order of the matrices
+     * @param inner Inner index of the shared pattern
+     * @param outer Outer index of the shared pattern
+     * @param data Values of each matrix, in the order of the pattern
+     * @param coefficients Coefficient of each matrix
+     * @param vec Vector to multiply with
+     * @param result Vector where the product is accumulated
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    void compressed_multiply_combination(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                                         std::span<const std::span<const T>> data, std::span<const T> coefficients,
+                                         std::span<const T> vec, std::span<T> result){
+        const std::size_t sz = inner.empty() ? 0 : inner.size() - 1;
+        const std::size_t nmat = data.size();
+        // Combined value of the non zero element k, summed in the order of linear_combination
+        auto value = [&](std::size_t k){
+            T combined{0};
+            for (std::size_t m = 0; m < nmat; ++m) {
+                combined += coefficients[m] * data[m][k];
+            }
+            return combined;
+        };
+        for (std::size_t idx = 0; idx < sz; ++idx) {
+            if constexpr(Order == StorageOrder::RowOrdering){
+                result[idx] += compressed_row_dot<T>(inner[idx], inner[idx + 1], outer, value, vec);
+            }
+            else{
+                for (std::size_t k = inner[idx]; k < inner[idx + 1]; ++k) {
+                    result[outer[k]] += value(k) * vec[idx];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Kernel of the norms in compressed format, shared by Matrix and MatrixView.
+     * The entries of inner are positions in outer and data: they do not need to start from 0.
+     *
+     * @tparam N Type of norm to compute (One, Infinity, Frobenius)
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     * @param inner Inner index (one entry per row/column, plus one)
+     * @param outer Outer index (column/row index of each non zero element)
+     * @param data Values of the non zero elements
+     * @param numrows Number of rows of the matrix
+     * @param numcols Number of columns of the matrix
+     * @return T The norm value
+     */
+    template<NormType N, RealOrComplex T, StorageOrder Order >
+    T compressed_norm(std::span<const std::size_t> inner, std::span<const std::size_t> outer,
+                      std::span<const T> data, std::size_t numrows, std::size_t numcols){
+        T norm_value = 0;
+        const std::size_t sz = inner.empty() ? 0 : inner.size() - 1;
+        if constexpr (N == NormType::Frobenius) {
+            // Frobenius norm (same for row or column ordering)
+            for (std::size_t k = inner.front(); k < inner.back(); ++k) {
+                norm_value += std::abs(data[k]) * std::abs(data[k]);
+            }
+            norm_value = std::sqrt(norm_value);
+        }
+        else if constexpr ((N == NormType::One) == (Order == StorageOrder::ColumnOrdering)) {
+            // One norm in column ordering, Infinity norm in row ordering: max of the sums along the inner index
+            T sum{0}; //variable to store the sum over the row/column
+            for (std::size_t idx = 0; idx < sz; ++idx) {
+                sum = 0;
+                for (std::size_t k = inner[idx]; k < inner[idx + 1]; ++k) {
+                    sum += std::abs(data[k]);
                 }
+                // Take the max
+                norm_value = std::max(norm_value, sum, complexLess<double>);
+            }
+        }
+        else {
+            // One norm in row ordering, Infinity norm in column ordering: sums along the outer index
+            std::vector<T> norms(Order == StorageOrder::RowOrdering ? numcols : numrows, 0);
+            for (std::size_t idx = 0; idx < sz; ++idx) {
+                for (std::size_t k = inner[idx]; k < inner[idx + 1]; ++k) {
+                    norms[outer[k]] += std::abs(data[k]);
+                }
+            }
+            // Take the max of the sums
+            if (!norms.empty()) {
+                norm_value = *std::max_element(norms.begin(), norms.end(), complexLess<double>);
+            }
+        }
+        return norm_value;
+    }
+
+    /**
+     * @brief Immutable sparsity pattern of a matrix in compressed format: dimensions, inner and outer index.
+     *
+     * The pattern is shared, through a std::shared_ptr<const SparsityPattern>, by all the matrices with the same
+     * structure (e.g. Jacobians at different time steps, mass and stiffness matrices on the same mesh):
+     * each of them stores only its values, in the order given by the pattern.
+     *
+     * @tparam Order The storage order of the pattern
+     */
+    template<StorageOrder Order>
+    class SparsityPattern {
+    public:
+        /**
+         * @brief Constructor: takes ownership of the two index vectors (no copy) and checks their consistency
+         *
+         * @param rows Number of rows
+         * @param cols Number of columns
+         * @param inner Inner index (rows+1 entries for RowOrdering, cols+1 for ColumnOrdering), starting from 0
+         * @param outer Outer index, sorted within each row/column
+         */
+        SparsityPattern(std::size_t rows, std::size_t cols, std::pmr::vector<std::size_t>&& inner,
+                        std::pmr::vector<std::size_t>&& outer)
+            : numrows(rows), numcols(cols), inner(std::move(inner)), outer(std::move(outer)){
+            const std::size_t sz = (Order == StorageOrder::RowOrdering) ? rows : cols;
+            const std::size_t other = (Order == StorageOrder::RowOrdering) ? cols : rows;
+            if (this->inner.size() != sz + 1 || this->inner.front() != 0 || this->inner.back() != this->outer.size()) {
+                throw std::invalid_argument("Inconsistent sizes of the compressed vectors.");
             }
+            if (!std::is_sorted(this->inner.begin(), this->inner.end())) {
+                throw std::invalid_argument("The inner index must be non decreasing.");
+            }
+            for (std::size_t idx : this->outer) {
+                if (idx >= other) {
+                    throw std::out_of_range("Outer index out of the matrix bounds.");
+                }
+            }
+        };
+
+        /**
+         * @brief Utility: returns the number of rows
+         */
+        std::size_t rows() const{ return numrows;};
+
+        /**
+         * @brief Utility: returns the number of columns
+         */
+        std::size_t cols() const{ return numcols;};
+
+        /**
+         * @brief Utility: returns the number of stored elements
+         */
+        std::size_t nonzeros() const{ return outer.size();};
+
+        /**
+         * @brief Utility: read-only access to the inner index
+         */
+        std::span<const std::size_t> inner_index() const{ return inner;};
+
+        /**
+         * @brief Utility: read-only access to the outer index
+         */
+        std::span<const std::size_t> outer_index() const{ return outer;};
+
+        /**
+         * @brief Two patterns are equal if they have the same dimensions and the same indices
+         */
+        bool operator==(const SparsityPattern& other) const{
+            return numrows == other.numrows && numcols == other.numcols && inner == other.inner && outer == other.outer;
+        };
+
+    private:
+        std::size_t numrows; //!< number of rows
+        std::size_t numcols; //!< number of columns
+        std::pmr::vector<std::size_t> inner; //!< inner index
+        std::pmr::vector<std::size_t> outer; //!< outer index
+    };
+
+
+    /**
+     * @brief Dictionary encoded values of a compressed matrix: a small table of distinct values and one code
+     * (position in the table) per non zero element
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Code Unsigned integer type of the codes
+     */
+    template<RealOrComplex T, typename Code>
+    struct DictionaryValues {
+        std::vector<T> table; //!< distinct values
+        std::pmr::vector<Code> codes; //!< code of each non zero element, in the order of the pattern
+    };
+
+    /**
+     * @brief Copy-on-write holder of a container of the Matrix storage (map or vector with a std::pmr allocator).
+     *
+     * Copies of the holder share the container. Reading never looks at the reference count; the first write()
+     * through a holder whose container is shared makes a private copy with the same memory resource (with the
+     * default resource if the container lives in an AssemblyArena, which serves a single container).
+     * As in the copy-on-write std::string of pre-C++11 libstdc++, a holder that handed out a mutable reference into
+     * its container (lend()) marks it unshareable: until the next assign() or clear(), its copies are deep, so
+     * writes through the reference never reach them.
+     *
+     * @tparam Storage The container type
+     */
+    template<typename Storage>
+    class CopyOnWrite {
+    public:
+        /**
+         * @brief Constructor: empty container using the given memory resource
+         */
+        explicit CopyOnWrite(std::pmr::memory_resource* resource) : storage(std::make_shared<Storage>(resource)){};
+
+        /**
+         * @brief Copy constructor: shares the container, unless it is unshareable
+         */
+        CopyOnWrite(const CopyOnWrite& other)
+            : storage(other.unshareable ? std::make_shared<Storage>(*other.storage, other.private_resource()) : other.storage){};
+
+        /**
+         * @brief Copy assignment: shares the container, unless it is unshareable
+         */
+        CopyOnWrite& operator=(const CopyOnWrite& other){
+            if (this != &other) {
+                storage = other.unshareable ? std::make_shared<Storage>(*other.storage, other.private_resource()) : other.storage;
+                unshareable = false;
+            }
+            return *this;
+        }
+
+        CopyOnWrite(CopyOnWrite&&) = default;
+        CopyOnWrite& operator=(CopyOnWrite&&) = default;
+
+        /**
+         * @brief Read-only access to the (possibly shared) container
+         */
+        const Storage& read() const{ return *storage;};
+
+        /**
+         * @brief Access for modification: makes a private copy first if the container is shared
+         */
+        Storage& write(){
+            if (shared()) {
+                storage = std::make_shared<Storage>(*storage, private_resource());
+            }
+            return *storage;
+        }
+
+        /**
+         * @brief Access for modification through a reference that the caller may keep: as write(), and the container
+         * becomes unshareable
+         */
+        Storage& lend(){
+            Storage& container = write();
+            unshareable = true;
+            return container;
+        }
+
+        /**
+         * @brief Replaces the container, without copying the old one
+         */
+        void assign(Storage&& other){
+            storage = std::make_shared<Storage>(std::move(other));
+            unshareable = false;
+        }
+
+        /**
+         * @brief Empties the container: a shared container is left to the other holders, not copied
+         */
+        void clear(){
+            if (shared()) {
+                storage = std::make_shared<Storage>(private_resource());
+            } else {
+                storage->clear();
+            }
+            unshareable = false;
+        }
+
+        /**
+         * @brief Utility: checks if the container is shared with other holders
+         */
+        bool shared() const{ return storage.use_count() > 1;};
+
+    private:
+        // Memory resource of a private copy
+        std::pmr::memory_resource* private_resource() const{
+            auto* resource = storage->get_allocator().resource();
+            return dynamic_cast<AssemblyArena*>(resource) != nullptr ? std::pmr::get_default_resource() : resource;
+        }
+
+        std::shared_ptr<Storage> storage; //!< the container, shared between copies until one of them writes
+        bool unshareable = false; //!< a mutable reference into the container was handed out (see lend())
+    };
+
+    // Declaration and definition of operator* (matrix-vector multiplication)
+    template<RealOrComplex T, StorageOrder Order >
+    std::vector<T> operator*(const Matrix<T, Order>& matrix, const std::vector<T>& vec){
+            std::vector<T> result(matrix.numrows);
+            matrix.apply(vec, result);
             return result;
         }
 
@@ -144,11 +754,11 @@ namespace algebra {
             std::vector<T> vecColumn; // vector to store the column
             if(vec.is_compressed()){
                  for (size_t i = 0; i < vec.numrows; ++i){
-                    vecColumn.push_back(vec.compressed_data[i]);
+                    vecColumn.push_back(vec.values()[i]);
                  }
             }
             else{
-                for (const auto& [coords, value] : vec.uncompressed_data){
+                for (const auto& [coords, value] : vec.uncompressed_data.read()){
                     vecColumn.push_back(value);
                     }
             }
@@ -158,6 +768,12 @@ namespace algebra {
 
     /**
      * @brief Sparse matrix class supporting compressed and uncompressed storage
+     *
+     * Copies are O(1): they share the storage (copy-on-write) until one of them is modified through the
+     * non-const call operator, the non-const values(), compress(), uncompress() or read().
+     * A reference or span handed out by the non-const call operator or values() makes the storage unshareable:
+     * the copies made afterwards are deep (until the next compress() or uncompress()), so writes through the
+     * reference or span never reach them.
      * 
      * @tparam T The type of elements in the matrix
      * @tparam Order The storage order of the matrix
@@ -170,13 +786,29 @@ namespace algebra {
         std::size_t numcols; /*!< number of columns of the matrix*/
         
         //!< type of data in uncompressed state
-        using MapData = std::map<std::array<std::size_t, 2>, T, CompareHelper<Order>>; 
-        MapData uncompressed_data;  //!< stores data in uncompressed state
+        using MapData = std::pmr::map<std::array<std::size_t, 2>, T, CompareHelper<Order>>; 
+        CopyOnWrite<MapData> uncompressed_data;  //!< stores data in uncompressed state (shared between copies)
        
         // stores data in compressed state
-        std::vector<std::size_t> compressed_inner; //!< stores inner index of compressed state
-        std::vector<std::size_t> compressed_outer; //!< stores outer index of compressed state
-        std::vector<T> compressed_data; //!< stores data of compressed state
+        std::shared_ptr<const SparsityPattern<Order>> compressed_pattern; //!< structure of compressed state, possibly shared
+        CopyOnWrite<std::pmr::vector<T>> compressed_data; //!< stores data of compressed state (shared between copies)
+        ValueEncoding value_encoding = ValueEncoding::Plain; //!< how the values of compressed state are stored
+        std::shared_ptr<const DictionaryValues<T, std::uint8_t>> dictionary8; //!< values with 8 bit codes
+        std::shared_ptr<const DictionaryValues<T, std::uint16_t>> dictionary16; //!< values with 16 bit codes
+
+        // Clears the uncompressed data, releasing an AssemblyArena at once
+        void clear_uncompressed();
+
+        // Value of the non zero element k of the compressed format, whatever the encoding
+        const T& value_at(std::size_t k) const;
+
+        // Multiplies every value by inner_scaling of its row (column for ColumnOrdering) and by outer_scaling of its
+        // column (row); an empty span leaves that dimension unscaled
+        void scale_compressed(std::span<const T> inner_scaling, std::span<const T> outer_scaling, std::size_t threads);
+
+        // Encodes the values with a dictionary of codes of type Code, returns false if there are too many distinct values
+        template<typename Code>
+        bool encode_dictionary(std::shared_ptr<const DictionaryValues<T, Code>>& dictionary);
 
     public:
         /**
@@ -184,11 +816,50 @@ namespace algebra {
          * 
          * @param rows Number of rows in the matrix
          * @param cols Number of columns in the matrix
+         * @param assembly_resource Memory resource of the map used in uncompressed format (e.g. an AssemblyArena)
+         * @param storage_resource Memory resource of the vectors used in compressed format
          */
-        Matrix(std::size_t rows, std::size_t cols): compressed(false), numrows(rows), numcols(cols){};
+        Matrix(std::size_t rows, std::size_t cols,
+               std::pmr::memory_resource* assembly_resource = std::pmr::get_default_resource(),
+               std::pmr::memory_resource* storage_resource = std::pmr::get_default_resource())
+            : compressed(false), numrows(rows), numcols(cols), uncompressed_data(assembly_resource),
+              compressed_data(storage_resource){};
 
         /**
-         * @brief Provides non-const access to matrix elements, can add element only for uncompressed matrix
+         * @brief Constructor: constructs a matrix in compressed format taking ownership of the three vectors
+         * (no copy, the vectors keep their memory resource)
+         * 
+         * @param rows Number of rows in the matrix
+         * @param cols Number of columns in the matrix
+         * @param inner Inner index (rows+1 entries for RowOrdering, cols+1 for ColumnOrdering), starting from 0
+         * @param outer Outer index, sorted within each row/column
+         * @param data Values of the non zero elements
+         */
+        Matrix(std::size_t rows, std::size_t cols, std::pmr::vector<std::size_t>&& inner,
+               std::pmr::vector<std::size_t>&& outer, std::pmr::vector<T>&& data);
+
+        /**
+         * @brief Constructor: constructs a matrix in compressed format sharing an existing sparsity pattern
+         *
+         * @param pattern Sparsity pattern (e.g. the pattern() of another matrix)
+         * @param data Values of the non zero elements, in the order of the pattern (moved, not copied)
+         */
+        Matrix(std::shared_ptr<const SparsityPattern<Order>> pattern, std::pmr::vector<T>&& data);
+
+        /**
+         * @brief Constructor: constructs a matrix in compressed format sharing an existing sparsity pattern,
+         * with all the stored elements equal to value
+         *
+         * @param pattern Sparsity pattern (e.g. the pattern() of another matrix)
+         * @param value Initial value of the stored elements
+         * @param storage_resource Memory resource of the values
+         */
+        Matrix(std::shared_ptr<const SparsityPattern<Order>> pattern, const T& value,
+               std::pmr::memory_resource* storage_resource = std::pmr::get_default_resource());
+
+        /**
+         * @brief Provides non-const access to matrix elements, can add element only for uncompressed matrix.
+         * The storage becomes unshareable: later copies of the matrix are deep and do not see writes through the reference
          * 
          * @param i Row index
          * @param j Column index
@@ -208,8 +879,29 @@ namespace algebra {
     
         /**
          * @brief Compresses the matrix data
+         *
+         * @param encoding How to store the values (see encode())
          */
-        void compress();
+        void compress(ValueEncoding encoding = ValueEncoding::Plain);
+
+        /**
+         * @brief Changes the storage of the values of a compressed matrix. With ValueEncoding::Automatic the most compact
+         * encoding is chosen: Pattern if all the values are 1, then Dictionary8 or Dictionary16 according to the number
+         * of distinct values, Plain otherwise. An encoded matrix is read-only: modifying it decodes it first.
+         *
+         * @param encoding The encoding
+         */
+        void encode(ValueEncoding encoding);
+
+        /**
+         * @brief Restores the plain storage of the values of a compressed matrix
+         */
+        void decode();
+
+        /**
+         * @brief Utility: returns the encoding of the values (Plain if uncompressed)
+         */
+        ValueEncoding encoding() const{ return value_encoding;};
 
         /**
          * @brief Uncompresses the matrix data
@@ -224,6 +916,115 @@ namespace algebra {
          */
         bool is_compressed() const{ return compressed;};
 
+        /**
+         * @brief Utility: returns the number of rows of the matrix
+         */
+        std::size_t rows() const{ return numrows;};
+
+        /**
+         * @brief Utility: returns the number of columns of the matrix
+         */
+        std::size_t cols() const{ return numcols;};
+
+        /**
+         * @brief Utility: returns the number of stored (non zero) elements
+         */
+        std::size_t nonzeros() const{ return is_compressed() ? compressed_pattern->nonzeros() : uncompressed_data.read().size();};
+
+        /**
+         * @brief Utility: returns the sparsity pattern of the compressed format (null if uncompressed).
+         * Matrices built from it share the same inner and outer index.
+         */
+        std::shared_ptr<const SparsityPattern<Order>> pattern() const{ return compressed_pattern;};
+
+        /**
+         * @brief Utility: read-only access to the inner index of the compressed format (empty if uncompressed)
+         */
+        std::span<const std::size_t> inner_index() const{
+            return compressed_pattern ? compressed_pattern->inner_index() : std::span<const std::size_t>{};
+        };
+
+        /**
+         * @brief Utility: read-only access to the outer index of the compressed format (empty if uncompressed)
+         */
+        std::span<const std::size_t> outer_index() const{
+            return compressed_pattern ? compressed_pattern->outer_index() : std::span<const std::size_t>{};
+        };
+
+        /**
+         * @brief Utility: read-only access to the values of the compressed format (empty if uncompressed);
+         * throws if the values are encoded (see decode())
+         */
+        std::span<const T> values() const{
+            if (value_encoding != ValueEncoding::Plain) {
+                throw std::runtime_error("The values are encoded, call decode() first.");
+            }
+            return compressed_data.read();
+        };
+
+        /**
+         * @brief Utility: access to the values of the compressed format (empty if uncompressed);
+         * the pattern stays untouched. Decodes the values if needed, and makes a private copy of them if they are
+         * shared with a copy of the matrix.
+         * The values become unshareable: later copies of the matrix are deep and do not see writes through the span.
+         */
+        std::span<T> values(){
+            decode();
+            return compressed_data.lend();
+        };
+
+        /**
+         * @brief Scales the rows of a compressed matrix in place, A = D A with D = diag(scaling); the rows
+         * (or the non zero elements, for ColumnOrdering) are split among threads. Decodes the values if needed.
+         *
+         * @param scaling One factor per row
+         * @param threads Number of threads
+         */
+        void scale_rows(std::span<const T> scaling, std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+
+        /**
+         * @brief Scales the columns of a compressed matrix in place, A = A D with D = diag(scaling)
+         *
+         * @param scaling One factor per column
+         * @param threads Number of threads
+         */
+        void scale_cols(std::span<const T> scaling, std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+
+        /**
+         * @brief Ruiz equilibration of a compressed matrix, in place: at every sweep the rows and the columns are
+         * divided by the square roots of their largest absolute values, until all of them are within tol of 1.
+         * The matrix becomes D_r A D_c, so that A x = b is solved as (D_r A D_c) y = D_r b, x = D_c y.
+         *
+         * @param max_sweeps Maximum number of sweeps
+         * @param tol Tolerance on the largest absolute value of every row and column
+         * @param threads Number of threads
+         * @return The scaling factors: D_r (one per row) and D_c (one per column)
+         */
+        std::pair<std::vector<T>, std::vector<T>> equilibrate(std::size_t max_sweeps = 20, double tol = 1e-2,
+                                                              std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1))
+            requires (!std::integral<T>);
+
+        /**
+         * @brief Removes from a compressed matrix the stored elements with absolute value not larger than tol
+         * (prune(0) removes the explicit zeros). The new arrays are filled in parallel: each thread counts the
+         * elements kept by its block of rows (columns for ColumnOrdering), the block totals are scanned, then each
+         * thread scans its own inner index and copies its elements. The matrix gets its own new sparsity pattern;
+         * matrices that shared the old one keep it.
+         *
+         * @param tol Drop tolerance
+         * @param threads Number of threads
+         * @return std::size_t Number of elements removed
+         */
+        std::size_t prune(double tol = 0, std::size_t threads = std::max<unsigned>(std::thread::hardware_concurrency(), 1));
+
+        /**
+         * @brief Matrix-vector product into an existing vector, y = A x (the LinearOperator interface)
+         *
+         * @param x Vector of cols() entries
+         * @param y Vector of rows() entries, overwritten with the product
+         */
+        void apply(std::span<const T> x, std::span<T> y) const;
+
         /**
          * @brief Utility: Prints the matrix
          */
@@ -309,10 +1110,111 @@ namespace algebra {
 
 
     };
+
+
+    /**
+     * @brief Utility: checks that two compressed matrices have the same sparsity pattern
+     * (the same shared object, or equal indices)
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    bool same_pattern(const Matrix<T, Order>& A, const Matrix<T, Order>& B){
+        return A.is_compressed() && B.is_compressed() && (A.pattern() == B.pattern() || *A.pattern() == *B.pattern());
+    }
+
+    /**
+     * @brief Linear combination alpha*A + beta*B of two compressed matrices with the same sparsity pattern.
+     * The result shares the pattern of A and is computed by a single loop over the values.
+     *
+     * @param alpha Coefficient of A
+     * @param A First matrix (compressed)
+     * @param beta Coefficient of B
+     * @param B Second matrix (compressed, same pattern as A)
+     * @return Matrix<T, Order> The linear combination
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    Matrix<T, Order> linear_combination(const T& alpha, const Matrix<T, Order>& A, const T& beta, const Matrix<T, Order>& B){
+        if (!same_pattern(A, B)) {
+            throw std::invalid_argument("The matrices must be compressed with the same sparsity pattern.");
+        }
+        auto a = A.values();
+        auto b = B.values();
+        std::pmr::vector<T> data(a.size());
+        for (std::size_t k = 0; k < data.size(); ++k) {
+            data[k] = alpha * a[k] + beta * b[k];
+        }
+        return Matrix<T, Order>(A.pattern(), std::move(data));
+    }
+
+    /**
+     * @brief Products A_m*vec of several compressed matrices with the same sparsity pattern, computed in one
+     * pass over the pattern (see compressed_multiply_multi)
+     *
+     * @param matrices The matrices (same pattern)
+     * @param vec Vector to multiply with
+     * @return std::vector<std::vector<T>> One resulting vector per matrix
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    std::vector<std::vector<T>> multiply_shared(const std::vector<const Matrix<T, Order>*>& matrices, const std::vector<T>& vec){
+        std::vector<std::vector<T>> results;
+        if (matrices.empty()) {
+            return results;
+        }
+        const Matrix<T, Order>& first = *matrices.front();
+        if (vec.size() != first.cols()) {
+            throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+        }
+        std::vector<std::span<const T>> data;
+        for (const auto* matrix : matrices) {
+            if (!same_pattern(first, *matrix)) {
+                throw std::invalid_argument("The matrices must be compressed with the same sparsity pattern.");
+            }
+            data.push_back(matrix->values());
+        }
+        results.assign(matrices.size(), std::vector<T>(first.rows(), T{0}));
+        std::vector<std::span<T>> outputs(results.begin(), results.end());
+        compressed_multiply_multi<T, Order>(first.inner_index(), first.outer_index(), data, vec, outputs);
+        return results;
+    }
+
+    /**
+     * @brief Product (sum_m coefficients[m]*A_m)*vec for compressed matrices with the same sparsity pattern,
+     * without forming the combined matrix (see compressed_multiply_combination)
+     *
+     * @param coefficients Coefficient of each matrix
+     * @param matrices The matrices (same pattern)
+     * @param vec Vector to multiply with
+     * @return std::vector<T> Resulting vector
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    std::vector<T> multiply_combination(const std::vector<T>& coefficients, const std::vector<const Matrix<T, Order>*>& matrices,
+                                        const std::vector<T>& vec){
+        if (matrices.empty() || coefficients.size() != matrices.size()) {
+            throw std::invalid_argument("One coefficient per matrix is needed.");
+        }
+        const Matrix<T, Order>& first = *matrices.front();
+        if (vec.size() != first.cols()) {
+            throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+        }
+        std::vector<std::span<const T>> data;
+        for (const auto* matrix : matrices) {
+            if (!same_pattern(first, *matrix)) {
+                throw std::invalid_argument("The matrices must be compressed with the same sparsity pattern.");
+            }
+            data.push_back(matrix->values());
+        }
+        std::vector<T> result(first.rows(), T{0});
+        compressed_multiply_combination<T, Order>(first.inner_index(), first.outer_index(), data, coefficients, vec, result);
+        return result;
+    }
 }// namespace algebra
 
 
 
+// Header-only configuration: the member functions are defined in every translation unit
+#ifdef ALGEBRA_HEADER_ONLY
+#include "sparse_matrix_impl.hpp"
+#endif
+
 #endif // SPARSE_MATRIX_HPP
 
 
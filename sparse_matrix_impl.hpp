@@ -0,0 +1,921 @@
+/**
+ * @file sparse_matrix_impl.hpp
+ * @brief Contains the implementation of the Matrix member functions.
+ *
+ * It is included by sparse_matrix.cpp, which instantiates the Matrix class for the supported element types.
+ * Defining ALGEBRA_HEADER_ONLY before including sparse_matrix.hpp (make HEADER_ONLY=1) includes it in every
+ * translation unit instead: element access, compression and the norms can then be inlined into the user code
+ * and any element type satisfying RealOrComplex can be used.
+ */
+
+#ifndef SPARSE_MATRIX_IMPL_HPP
+#define SPARSE_MATRIX_IMPL_HPP
+
+#include "sparse_matrix.hpp"
+
+
+namespace algebra {
+
+    // Random vector generation
+    template<RealOrComplex T, StorageOrder Order>
+    std::vector<T> generateRandomVector(const Matrix<T, Order>& matrix){
+            std::cout<<"\nCreating a random vector to perform matrix multiplication..."<<std::endl;
+            std::vector<T> randomVector(matrix.numcols); // Vector length equal to number of columns
+            
+            // Use a random device and Mersenne Twister engine for random number generation
+            std::random_device rd;
+            std::mt19937 gen(rd());
+
+            // Fill the vector with random values: in [0.0, 1.0] for floating point and complex types
+            // (real and imaginary part), in [0, 9] for integer types
+            for (std::size_t i = 0; i < matrix.numcols; ++i) {
+                if constexpr (Complex<T>) {
+                    std::uniform_real_distribution<typename T::value_type> dist(0.0, 1.0);
+                    randomVector[i] = T(dist(gen), dist(gen));
+                } else if constexpr (std::is_integral_v<T>) {
+                    std::uniform_int_distribution<T> dist(0, 9);
+                    randomVector[i] = dist(gen);
+                } else {
+                    std::uniform_real_distribution<T> dist(0.0, 1.0);
+                    randomVector[i] = dist(gen); // Generate random value
+                }
+            }
+            return randomVector;
+        }
+
+
+    // Constructor from the three vectors of the compressed format: the vectors are moved, not copied
+    template<RealOrComplex T, StorageOrder Order>
+    Matrix<T, Order>::Matrix(std::size_t rows, std::size_t cols, std::pmr::vector<std::size_t>&& inner,
+                             std::pmr::vector<std::size_t>&& outer, std::pmr::vector<T>&& data)
+        : Matrix(std::make_shared<const SparsityPattern<Order>>(rows, cols, std::move(inner), std::move(outer)),
+                 std::move(data)){}
+
+
+
+    // Constructor from a shared sparsity pattern and the values: only the values are owned by the matrix
+    template<RealOrComplex T, StorageOrder Order>
+    Matrix<T, Order>::Matrix(std::shared_ptr<const SparsityPattern<Order>> pattern, std::pmr::vector<T>&& data)
+        : compressed(true), numrows(0), numcols(0), uncompressed_data(std::pmr::get_default_resource()),
+          compressed_pattern(std::move(pattern)), compressed_data(data.get_allocator().resource()){
+        if (!compressed_pattern) {
+            throw std::invalid_argument("Null sparsity pattern.");
+        }
+        if (data.size() != compressed_pattern->nonzeros()) {
+            throw std::invalid_argument("The number of values does not match the sparsity pattern.");
+        }
+        numrows = compressed_pattern->rows();
+        numcols = compressed_pattern->cols();
+        compressed_data.assign(std::move(data));
+    }
+
+
+
+    // Constructor from a shared sparsity pattern, with all the stored elements equal to value
+    template<RealOrComplex T, StorageOrder Order>
+    Matrix<T, Order>::Matrix(std::shared_ptr<const SparsityPattern<Order>> pattern, const T& value,
+                             std::pmr::memory_resource* storage_resource)
+        : Matrix(pattern, std::pmr::vector<T>(pattern ? pattern->nonzeros() : 0, value, storage_resource)){}
+
+
+
+    // Utility function to access elements in compressed format
+    template<RealOrComplex T, StorageOrder Order>
+    auto Matrix<T, Order>::compressed_access(std::size_t i, std::size_t j) {
+            // Look for the element
+            //if j is in the interval [ outer[inner[i]], outer[inner[i+1]] ), then A[i,j] exists
+            auto inner = inner_index();
+            auto outer = outer_index();
+            std::size_t row_start = inner[i];
+            std::size_t row_end = inner[i + 1];
+            auto it = std::find (outer.begin() + row_start,
+                                 outer.begin() + row_end, j); 
+            return it;
+    }
+
+
+
+     // Utility function to access elements in compressed format (const version)
+    template<RealOrComplex T, StorageOrder Order>
+    const auto Matrix<T, Order>::compressed_access(std::size_t i, std::size_t j) const{
+            // Look for the element
+            //if j is in the interval [ outer[inner[i]], outer[inner[i+1]] ), then A[i,j] exists
+            auto inner = inner_index();
+            auto outer = outer_index();
+            std::size_t row_start = inner[i];
+            std::size_t row_end = inner[i + 1];
+            auto it = std::find (outer.begin() + row_start,
+                                 outer.begin() + row_end, j); 
+            return it;
+    }
+
+
+
+    // Call operator, non const version: can add elements if matrix in uncompressed format,
+    // can only modify existing elements if in compressed format
+    template<RealOrComplex T, StorageOrder Order>
+    T& Matrix<T, Order>::operator()(std::size_t i, std::size_t j) {
+        if (!is_compressed()) {
+            // Uncompressed format, I can add new elements 
+            if(i >=numrows || j >=numcols){
+                resize(i,j); // Adding the element increases the size of the matrix
+            }
+            return uncompressed_data.lend()[{i,j}]; // Creates new data if element not found (private copy if shared)
+        }
+        else{
+            // Compressed format, I CANNOT add new elements
+            decode(); // encoded values are read-only
+            if(i >=numrows || j >=numcols){
+                // If position out of matrix bounds
+                throw std::out_of_range("Matrix in compressed form, cannot add new elements!");
+            }
+            else{
+                // Look for the element
+                auto outer = outer_index();
+                auto it = outer.begin();
+                std::size_t row_end{0};   
+                if constexpr(Order == StorageOrder::RowOrdering){
+                    // Row ordering
+                    it = compressed_access(i,j); // access to element ij in compress format (row ordering)
+                    row_end = inner_index()[i + 1];
+                }
+                else{
+                    //column ordering
+                    it = compressed_access(j,i); // access to element ij in compress format (column ordering)
+                    row_end = inner_index()[j + 1];
+                    }
+                
+                if (it != outer.begin() + row_end) {
+                    // If element is present
+                    std::size_t index = std::distance(outer.begin(), it);
+                    return compressed_data.lend().at(index); // private copy of the values if shared
+                }
+                else{
+                    // If element is not present
+                    throw std::out_of_range("Matrix in compressed form, cannot add new elements!");
+                }
+            }
+        }
+    }
+
+
+
+    // Call operator, const version; returns 0 if the element is in matrix range but not present
+    template<RealOrComplex T, StorageOrder Order>
+    const T& Matrix<T, Order>::operator()(std::size_t i, std::size_t j) const {
+        if (i >= numrows || j >= numcols) {
+              throw std::out_of_range("Index out of boundary"); //if indexes out of range
+        }
+
+        // Uncompressed format
+        if (!is_compressed()){
+            auto it = uncompressed_data.read().find({i,j});
+            // If we found the element
+            if (it != uncompressed_data.read().end()) {
+                return it->second;
+            }
+            // If we didn't find the element, return 0
+            else{ 
+                 static T default_value{};
+                 return default_value; 
+            }
+        }
+        // Compressed format
+        else{
+            auto outer = outer_index();
+            auto it = outer.begin();
+            std::size_t row_end{0};
+
+            if constexpr(Order == StorageOrder::RowOrdering){
+                // Row ordering
+                it =compressed_access(i,j);
+                row_end = inner_index()[i + 1];
+                }
+            else{
+                // Column ordering
+                it = compressed_access(j,i);
+                row_end = inner_index()[j + 1];
+                }          
+
+        // If we found the element
+        if (it != outer.begin() + row_end) {
+            std::size_t index = std::distance(outer.begin(), it);
+            return value_at(index);
+            }
+
+        //If we didn't find the element, return 0
+        else{
+            static T default_value{};
+            return default_value; 
+            }
+        }
+    }
+
+
+
+    // Compresses an uncompressed matrix
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::compress(ValueEncoding encoding) {
+       if (is_compressed()) {
+            // Matrix is already compressed, no need to compress again
+            if (encoding != ValueEncoding::Plain) {
+                encode(encoding);
+            }
+            return;
+        }
+
+        // The new vectors use the same resource as the values; the map is only read
+        const MapData& uncompressed = uncompressed_data.read();
+        auto storage_resource = compressed_data.read().get_allocator();
+        std::pmr::vector<std::size_t> compressed_inner(storage_resource);
+        std::pmr::vector<std::size_t> compressed_outer(storage_resource);
+        std::pmr::vector<T> compressed_values(storage_resource);
+        std::size_t sz{0};
+
+        if constexpr (Order == StorageOrder::RowOrdering) {
+            sz = numrows;
+        } else if constexpr (Order == StorageOrder::ColumnOrdering) {
+            sz = numcols;
+        }
+
+        // reserve space
+        compressed_inner.reserve(sz + 1); 
+        compressed_outer.reserve(uncompressed.size()); 
+        compressed_values.reserve(uncompressed.size()); 
+
+        // Consider one row/column at a time
+        std::size_t idx{0}; //counter for current row/column 
+        std::size_t count{0}; //counter for current element
+        auto start = uncompressed.begin();
+        auto end = uncompressed.end();
+        auto coords = start->first;
+         
+        while(idx!=sz){
+            compressed_inner.emplace_back(count); 
+            if constexpr(Order == StorageOrder::RowOrdering){
+                // Consider row idx
+                start = uncompressed.lower_bound({idx, 0});
+                end = uncompressed.upper_bound({idx, std::numeric_limits<std::size_t>::max()});
+            }
+            else{
+                // Consider column idx
+                start = uncompressed.lower_bound({0, idx});
+                end = uncompressed.upper_bound({std::numeric_limits<std::size_t>::max(), idx});
+            }
+
+            for (auto it = start ; it!= end; ++it){
+                // Traverse the row/column
+                coords = it->first;
+                if constexpr(Order == StorageOrder::RowOrdering){
+                    // Store the column index in the outer vector
+                    compressed_outer.emplace_back(coords[1]); 
+                }
+                else{
+                    // Store the row index in the outer vector
+                    compressed_outer.emplace_back(coords[0]); 
+                }
+                // Store the value 
+                compressed_values.emplace_back(it->second);  
+                count++;
+                }
+            idx++; // increase current row/column
+        }
+        // For the last row/column: add fictitious index after the last valid index
+        compressed_inner.emplace_back(count);
+        compressed_pattern = std::make_shared<const SparsityPattern<Order>>(numrows, numcols, std::move(compressed_inner),
+                                                                            std::move(compressed_outer));
+        compressed_data.assign(std::move(compressed_values));
+
+        // Clear uncompressed data after compression
+        clear_uncompressed();
+        compressed = true; // Set compressed flag
+        if (encoding != ValueEncoding::Plain) {
+            encode(encoding);
+        }
+    }
+
+
+
+    // Value of the non zero element k of the compressed format
+    template<RealOrComplex T, StorageOrder Order>
+    const T& Matrix<T, Order>::value_at(std::size_t k) const {
+        static const T one{1};
+        switch (value_encoding) {
+        case ValueEncoding::Dictionary8:
+            return dictionary8->table[dictionary8->codes[k]];
+        case ValueEncoding::Dictionary16:
+            return dictionary16->table[dictionary16->codes[k]];
+        case ValueEncoding::Pattern:
+            return one;
+        default:
+            return compressed_data.read()[k];
+        }
+    }
+
+
+
+    // Builds the table of distinct values and the codes; gives up if there are more distinct values than codes
+    template<RealOrComplex T, StorageOrder Order>
+    template<typename Code>
+    bool Matrix<T, Order>::encode_dictionary(std::shared_ptr<const DictionaryValues<T, Code>>& dictionary) {
+        // Total order on the values (lexicographic for complex numbers)
+        auto less = [](const T& lhs, const T& rhs){
+            if constexpr (Complex<T>) {
+                return lhs.real() < rhs.real() || (lhs.real() == rhs.real() && lhs.imag() < rhs.imag());
+            } else {
+                return lhs < rhs;
+            }
+        };
+        constexpr std::size_t max_codes = std::size_t{std::numeric_limits<Code>::max()} + 1;
+        std::map<T, Code, decltype(less)> codes(less);
+        auto encoded = std::make_shared<DictionaryValues<T, Code>>();
+        encoded->codes = std::pmr::vector<Code>(compressed_data.read().get_allocator());
+        encoded->codes.reserve(compressed_data.read().size());
+        for (const T& value : compressed_data.read()) {
+            auto [it, inserted] = codes.try_emplace(value, static_cast<Code>(codes.size()));
+            if (inserted) {
+                if (codes.size() > max_codes) {
+                    return false;
+                }
+                encoded->table.push_back(value);
+            }
+            encoded->codes.push_back(it->second);
+        }
+        dictionary = std::move(encoded);
+        return true;
+    }
+
+
+
+    // Changes the storage of the values of a compressed matrix
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::encode(ValueEncoding encoding) {
+        if (!is_compressed()) {
+            throw std::runtime_error("Only a compressed matrix can be encoded.");
+        }
+        decode();
+        const auto& data = compressed_data.read();
+        const bool all_ones = std::all_of(data.begin(), data.end(), [](const T& value){ return value == T{1};});
+        bool encoded = false;
+        if (encoding == ValueEncoding::Pattern || (encoding == ValueEncoding::Automatic && all_ones)) {
+            if (!all_ones) {
+                throw std::invalid_argument("Pattern encoding requires all the values equal to 1.");
+            }
+            value_encoding = ValueEncoding::Pattern;
+            encoded = true;
+        }
+        else if (encoding == ValueEncoding::Dictionary8 || encoding == ValueEncoding::Automatic) {
+            encoded = encode_dictionary(dictionary8);
+            value_encoding = encoded ? ValueEncoding::Dictionary8 : ValueEncoding::Plain;
+        }
+        if (!encoded && (encoding == ValueEncoding::Dictionary16 || encoding == ValueEncoding::Automatic)) {
+            encoded = encode_dictionary(dictionary16);
+            value_encoding = encoded ? ValueEncoding::Dictionary16 : ValueEncoding::Plain;
+        }
+        if (!encoded && encoding != ValueEncoding::Plain && encoding != ValueEncoding::Automatic) {
+            throw std::invalid_argument("Too many distinct values for the requested encoding.");
+        }
+        if (encoded) {
+            compressed_data.clear(); // the plain values are no longer needed
+        }
+    }
+
+
+
+    // Restores the plain storage of the values
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::decode() {
+        if (value_encoding == ValueEncoding::Plain) {
+            return;
+        }
+        std::pmr::vector<T> data(compressed_data.read().get_allocator());
+        data.reserve(nonzeros());
+        for (std::size_t k = 0; k < nonzeros(); ++k) {
+            data.push_back(value_at(k));
+        }
+        compressed_data.assign(std::move(data));
+        value_encoding = ValueEncoding::Plain;
+        dictionary8.reset();
+        dictionary16.reset();
+    }
+
+
+
+    // Clears the map of the uncompressed format. If its nodes come from an AssemblyArena they are not
+    // visited one by one: the map is abandoned and the arena released in one go (unless a copy still uses it)
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::clear_uncompressed() {
+        auto* arena = dynamic_cast<AssemblyArena*>(uncompressed_data.read().get_allocator().resource());
+        if (arena == nullptr || uncompressed_data.shared()) {
+            uncompressed_data.clear();
+            return;
+        }
+        // Keys and values are trivially destructible: a new empty map can take the place of the old one
+        static_assert(std::is_trivially_destructible_v<T>);
+        std::construct_at(&uncompressed_data.write(), arena);
+        arena->release();
+    }
+
+
+
+    // Uncompresses a compressed matrix
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::uncompress() {
+       if (!is_compressed()) {
+            return; // Matrix is already uncompressed, no need to uncompress again
+        }
+        uncompressed_data.clear();
+        MapData& uncompressed = uncompressed_data.write(); // not shared after clear(): no copy
+        auto compressed_inner = inner_index();
+        auto compressed_outer = outer_index();
+        decode();
+        const auto& compressed_values = compressed_data.read();
+        if constexpr(Order == StorageOrder::RowOrdering){
+            // Compressed format (CSR)
+            for (std::size_t i = 0; i < numrows; ++i) {
+                // Traverse the matrix by rows
+                std::size_t row_start = compressed_inner[i];
+                std::size_t row_end = inner_index()[i + 1];
+                // Consider elements of row i                 
+                for (std::size_t k = row_start; k < row_end; ++k) {
+                        std::size_t col_index = compressed_outer[k];
+                        T value = compressed_values[k];
+                        uncompressed[{i, col_index}] = value;
+                }
+            }
+        }
+        else{
+             // Compressed format (CSC)
+             for (std::size_t j = 0; j < numcols; ++j) {
+                // Traverse matrix by columns
+                std::size_t col_start = compressed_inner[j];
+                std::size_t col_end = compressed_inner[j + 1];
+                // Consider elements of column j 
+                for (std::size_t k = col_start; k < col_end; ++k) {
+                        std::size_t row_index = compressed_outer[k];
+                        T value = compressed_values[k];
+                        uncompressed[{row_index, j}] = value;
+                }
+            }  
+        }
+
+        // clear compressed data (the pattern is only released, other matrices may share it) and set compressed flag as false
+        compressed_pattern.reset();
+        compressed_data.clear();
+        compressed = false;
+    }
+
+
+
+    // Number of blocks of the inner index processed by the in-place operations: one per thread, at least 1024
+    // rows (columns) each
+    inline std::size_t compressed_blocks(std::size_t size, std::size_t threads){
+        return std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(size / 1024, 1));
+    }
+
+    // Runs work(block, first, last) on blocks of [0, size), the first one on the calling thread
+    template<typename Function>
+    void parallel_blocks(std::size_t size, std::size_t blocks, Function&& work){
+        std::vector<std::thread> workers;
+        for (std::size_t b = 1; b < blocks; ++b) {
+            workers.emplace_back([&, b]{ work(b, size * b / blocks, size * (b + 1) / blocks);});
+        }
+        work(0, 0, size / blocks);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+
+
+    // Scaling of the values along the inner and the outer index, split by blocks of the inner index
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::scale_compressed(std::span<const T> inner_scaling, std::span<const T> outer_scaling, std::size_t threads) {
+        if (!is_compressed()) {
+            throw std::runtime_error("Only a compressed matrix can be scaled in place.");
+        }
+        auto inner = inner_index();
+        auto outer = outer_index();
+        std::span<T> data = values();
+        const std::size_t sz = inner.size() - 1;
+        parallel_blocks(sz, compressed_blocks(sz, threads), [&](std::size_t, std::size_t first, std::size_t last){
+            for (std::size_t i = first; i < last; ++i) {
+                const T factor = inner_scaling.empty() ? T{1} : inner_scaling[i];
+                if (outer_scaling.empty()) {
+                    for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                        data[k] *= factor;
+                    }
+                } else {
+                    for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                        data[k] *= factor * outer_scaling[outer[k]];
+                    }
+                }
+            }
+        });
+    }
+
+
+
+    // Row scaling: along the inner index for RowOrdering, along the outer index for ColumnOrdering
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::scale_rows(std::span<const T> scaling, std::size_t threads) {
+        if (scaling.size() != numrows) {
+            throw std::invalid_argument("One scaling factor per row is needed.");
+        }
+        if constexpr (Order == StorageOrder::RowOrdering) {
+            scale_compressed(scaling, {}, threads);
+        } else {
+            scale_compressed({}, scaling, threads);
+        }
+    }
+
+
+
+    // Column scaling: along the outer index for RowOrdering, along the inner index for ColumnOrdering
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::scale_cols(std::span<const T> scaling, std::size_t threads) {
+        if (scaling.size() != numcols) {
+            throw std::invalid_argument("One scaling factor per column is needed.");
+        }
+        if constexpr (Order == StorageOrder::RowOrdering) {
+            scale_compressed({}, scaling, threads);
+        } else {
+            scale_compressed(scaling, {}, threads);
+        }
+    }
+
+
+
+    // Ruiz equilibration. The largest absolute values along the inner index are computed block by block; those
+    // along the outer index are reduced from one partial vector per block
+    template<RealOrComplex T, StorageOrder Order>
+    std::pair<std::vector<T>, std::vector<T>> Matrix<T, Order>::equilibrate(std::size_t max_sweeps, double tol, std::size_t threads)
+        requires (!std::integral<T>) {
+        if (!is_compressed()) {
+            throw std::runtime_error("Only a compressed matrix can be scaled in place.");
+        }
+        decode();
+        auto inner = inner_index();
+        auto outer = outer_index();
+        const std::size_t sz = inner.size() - 1;
+        const std::size_t other = (Order == StorageOrder::RowOrdering) ? numcols : numrows;
+        const std::size_t blocks = compressed_blocks(sz, threads);
+        std::vector<T> inner_total(sz, T{1}), outer_total(other, T{1});
+        std::vector<T> inner_step(sz), outer_step(other);
+        std::vector<std::vector<double>> outer_partial(blocks, std::vector<double>(other));
+        std::vector<double> inner_max(sz);
+
+        for (std::size_t sweep = 0; sweep < max_sweeps; ++sweep) {
+            const std::span<const T> data = compressed_data.read();
+            parallel_blocks(sz, blocks, [&](std::size_t b, std::size_t first, std::size_t last){
+                std::fill(outer_partial[b].begin(), outer_partial[b].end(), 0.0);
+                for (std::size_t i = first; i < last; ++i) {
+                    inner_max[i] = 0;
+                    for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                        const double magnitude = std::abs(data[k]);
+                        inner_max[i] = std::max(inner_max[i], magnitude);
+                        outer_partial[b][outer[k]] = std::max(outer_partial[b][outer[k]], magnitude);
+                    }
+                }
+            });
+            // An empty row or column is left unscaled
+            double deviation = 0;
+            for (std::size_t i = 0; i < sz; ++i) {
+                inner_step[i] = inner_max[i] > 0 ? static_cast<T>(1 / std::sqrt(inner_max[i])) : T{1};
+                deviation = inner_max[i] > 0 ? std::max(deviation, std::abs(1 - inner_max[i])) : deviation;
+            }
+            for (std::size_t j = 0; j < other; ++j) {
+                double outer_max = 0;
+                for (const auto& partial : outer_partial) {
+                    outer_max = std::max(outer_max, partial[j]);
+                }
+                outer_step[j] = outer_max > 0 ? static_cast<T>(1 / std::sqrt(outer_max)) : T{1};
+                deviation = outer_max > 0 ? std::max(deviation, std::abs(1 - outer_max)) : deviation;
+            }
+            if (deviation <= tol) {
+                break;
+            }
+            scale_compressed(inner_step, outer_step, threads);
+            for (std::size_t i = 0; i < sz; ++i) {
+                inner_total[i] *= inner_step[i];
+            }
+            for (std::size_t j = 0; j < other; ++j) {
+                outer_total[j] *= outer_step[j];
+            }
+        }
+        if constexpr (Order == StorageOrder::RowOrdering) {
+            return {std::move(inner_total), std::move(outer_total)};
+        } else {
+            return {std::move(outer_total), std::move(inner_total)};
+        }
+    }
+
+
+
+    // Drop tolerance filtering: count per block, scan of the block totals, then scan and copy per block
+    template<RealOrComplex T, StorageOrder Order>
+    std::size_t Matrix<T, Order>::prune(double tol, std::size_t threads) {
+        if (!is_compressed()) {
+            throw std::runtime_error("Only a compressed matrix can be pruned.");
+        }
+        decode();
+        auto inner = inner_index();
+        auto outer = outer_index();
+        const std::pmr::vector<T>& data = compressed_data.read();
+        const std::size_t sz = inner.size() - 1;
+        const std::size_t blocks = compressed_blocks(sz, threads);
+
+        // new_inner[i + 1] first holds the number of elements kept in row (column) i
+        auto storage_resource = data.get_allocator();
+        std::pmr::vector<std::size_t> new_inner(sz + 1, 0, storage_resource);
+        std::vector<std::size_t> block_offset(blocks + 1, 0);
+        parallel_blocks(sz, blocks, [&](std::size_t b, std::size_t first, std::size_t last){
+            for (std::size_t i = first; i < last; ++i) {
+                std::size_t count = 0;
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    count += std::abs(data[k]) > tol;
+                }
+                new_inner[i + 1] = count;
+                block_offset[b + 1] += count;
+            }
+        });
+        std::partial_sum(block_offset.begin(), block_offset.end(), block_offset.begin());
+        const std::size_t removed = nonzeros() - block_offset.back();
+        if (removed == 0) {
+            return 0;
+        }
+
+        std::pmr::vector<std::size_t> new_outer(block_offset.back(), storage_resource);
+        std::pmr::vector<T> new_data(block_offset.back(), storage_resource);
+        parallel_blocks(sz, blocks, [&](std::size_t b, std::size_t first, std::size_t last){
+            std::size_t position = block_offset[b];
+            for (std::size_t i = first; i < last; ++i) {
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    if (std::abs(data[k]) > tol) {
+                        new_outer[position] = outer[k];
+                        new_data[position] = data[k];
+                        ++position;
+                    }
+                }
+                new_inner[i + 1] = position;
+            }
+        });
+        compressed_pattern = std::make_shared<const SparsityPattern<Order>>(numrows, numcols, std::move(new_inner), std::move(new_outer));
+        compressed_data.assign(std::move(new_data));
+        return removed;
+    }
+
+
+
+    // Matrix-vector product: traversal of the map in uncompressed format, kernel of the encoding in compressed format
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::apply(std::span<const T> x, std::span<T> y) const {
+        if (x.size() != numcols || y.size() != numrows) {
+            throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+        }
+        std::fill(y.begin(), y.end(), T{0});
+        if (!is_compressed()) {
+            for (const auto& [coords, value] : uncompressed_data.read()) {
+                y[coords[0]] += value * x[coords[1]];
+            }
+            return;
+        }
+        switch (value_encoding) {
+        case ValueEncoding::Dictionary8:
+            compressed_multiply_dictionary<T, Order, std::uint8_t>(inner_index(), outer_index(), dictionary8->codes,
+                                                                   dictionary8->table, x, y);
+            break;
+        case ValueEncoding::Dictionary16:
+            compressed_multiply_dictionary<T, Order, std::uint16_t>(inner_index(), outer_index(), dictionary16->codes,
+                                                                    dictionary16->table, x, y);
+            break;
+        case ValueEncoding::Pattern:
+            compressed_multiply_pattern<T, Order>(inner_index(), outer_index(), x, y);
+            break;
+        default:
+            compressed_multiply<T, Order>(inner_index(), outer_index(), values(), x, y);
+        }
+    }
+
+
+
+    // Prints matrix of not too big dimensions
+    // If the matrix is in uncompressed format, it renders the view and prints also zeros
+    // If the matrix is in compressed format, it prints the 3 vectors (inner, outer, data)
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::print() const {
+            if (!is_compressed()) {
+                // Print elements in uncompressed form
+                std::cout << "Matrix (" << numrows << "x" << numcols << ") in non-compressed form:\n";
+                if(numrows>20||numcols>20){
+                    std::cerr<<"Matrix too big to be printed."<<std::endl;
+                    return;
+                    }
+                for (std::size_t i = 0; i < numrows; ++i) {
+                    for (std::size_t j = 0; j < numcols; ++j) {
+                        T v = operator()(i,j);
+                        std::cout<<v<< " ";
+                    }
+                    std::cout << '\n'; // Move to the next line after each row
+                }
+            } else {
+                // Print elements in compressed format
+                std::cout << "Matrix (" << numrows << "x" << numcols << ") in compressed form:\n";
+                if(numrows>20||numcols>20){
+                    std::cerr<<"Matrix too big to be printed."<<std::endl;
+                    return;
+                }
+                auto compressed_inner = inner_index();
+                auto compressed_outer = outer_index();
+                std::cout << "Inner Index: ";
+                for (size_t i = 0; i < compressed_inner.size(); ++i) {
+                    std::cout << compressed_inner[i] << " ";
+                }
+                std::cout << std::endl;
+
+                std::cout << "Outer Index: ";
+                for (size_t i = 0; i < compressed_outer.size(); ++i) {
+                    std::cout << compressed_outer[i] << " ";
+                }
+                std::cout << std::endl;
+
+                std::cout << "Compressed Data: ";
+                for (size_t i = 0; i < nonzeros(); ++i) {
+                    std::cout << value_at(i) << " ";
+                }
+                std::cout << std::endl;
+            }
+        }
+    
+
+    
+    
+    // Resize method 
+    template<RealOrComplex T, StorageOrder Order>
+    void Matrix<T, Order>::resize(std::size_t rows, std::size_t cols) {
+            if(!is_compressed()){
+                numrows = rows;
+                numcols = cols;
+            }
+    }
+
+
+
+   
+    // Reads matrix in matrix market format from a file
+    template<RealOrComplex T, StorageOrder Order>
+    void  Matrix<T, Order>::read(const std::string& file_name){
+        std::ifstream file(file_name);
+        if (!file.is_open()) {
+            std::cerr << "Error, to open the file: " << file_name << std::endl;
+            return;
+        }
+
+        std::string line;
+        std::getline(file, line); // read the first line 
+        
+        // Check on the format of the first line
+        if (line.substr(0, 14) != "%%MatrixMarket") {
+            std::cerr << "Eror the file is not in format Matrix Market" << std::endl;
+        }
+        // Pattern files have no values (every entry is 1), symmetric, skew-symmetric and hermitian files store only the lower triangle
+        const bool pattern = line.find("pattern") != std::string::npos;
+        const bool complex_field = line.find("complex") != std::string::npos;
+        const MatrixMarketSymmetry symmetry = matrix_market_symmetry(line);
+
+        while (std::getline(file, line) && line[0] == '%') {
+            // Ignore comments
+        }
+
+        // Read numbers of rows,columns and non zero elements
+        std::size_t numNonZero;
+        std::string numRowsStr, numColsStr, numNonZeroStr;
+        std::istringstream iss(line);
+        if(!(iss >> numRowsStr >> numColsStr >> numNonZeroStr)) {
+            throw std::runtime_error("Error during the reading");
+        }
+
+        auto numRows = std::stoul(numRowsStr);
+        auto numCols = std::stoul(numColsStr);
+        numNonZero = std::stoul(numNonZeroStr);
+        std::cout<<"Matrix read from file, in uncompressed format!"<<std::endl;
+        std::cout <<"rows: "<< numRows<<", columns: "<< numCols<< ", non zero elements: "<< numNonZero<<std::endl;
+        resize(numRows,numCols);
+        MapData& uncompressed = uncompressed_data.write();
+
+        // Read the non zero element
+        while(std::getline(file,line)){
+            std::istringstream elementStream(line);
+            std::string nrow,ncol,val,imag;
+            elementStream >> nrow >> ncol >> val >> imag;
+            std::size_t row,col;
+            row = std::stoul(nrow);
+            col = std::stoul(ncol);
+            T value = static_cast<T>(pattern ? 1.0 : std::stod(val));
+            if constexpr (Complex<T>) {
+                if (complex_field) {
+                    value = T(std::stod(val), std::stod(imag));
+                }
+            }
+            if (symmetry == MatrixMarketSymmetry::SkewSymmetric && row == col) {
+                throw std::runtime_error("Diagonal entry in a skew-symmetric file: " + file_name);
+            }
+            uncompressed[{row-1,col-1}]= value;
+            if (symmetry != MatrixMarketSymmetry::General && row != col) {
+                uncompressed[{col-1,row-1}]= matrix_market_mirror(symmetry, value);
+            }
+        }
+        // Close the file
+        file.close();
+    }
+
+
+
+    // Computes the norm of the matrix: options are One norm, Infinity norm and Frobenius norm
+    template<RealOrComplex T, StorageOrder Order>
+    template<NormType N>
+    T Matrix<T, Order>::norm() const {
+        T norm_value = 0;
+        const MapData& uncompressed_data = this->uncompressed_data.read();
+
+        if(is_compressed()){
+            // COMPRESSED format (same kernel as MatrixView)
+            if (value_encoding == ValueEncoding::Plain) {
+                norm_value = compressed_norm<N, T, Order>(inner_index(), outer_index(), values(), numrows, numcols);
+            } else {
+                std::vector<T> decoded(nonzeros());
+                for (std::size_t k = 0; k < decoded.size(); ++k) {
+                    decoded[k] = value_at(k);
+                }
+                norm_value = compressed_norm<N, T, Order>(inner_index(), outer_index(), decoded, numrows, numcols);
+            }
+        }else{
+        // UNCOMPRESSED format
+        if constexpr (N == NormType::Frobenius) {
+            // Frobenius norm computation for compressed matrix (same for row or column ordering)
+            for (const auto& [coords, value] : uncompressed_data) {
+                    norm_value += std::abs(value) * std::abs(value);
+            }
+            norm_value = std::sqrt(norm_value);
+        }
+
+        else if constexpr (Order == StorageOrder::RowOrdering) {
+            // Row ordering in uncompressed format
+            if constexpr (N == NormType::One) {
+                // One - norm computation for uncompressed matrix, row ordering
+                std::vector<T> norms(numcols, 0); // vector to store the sums by column
+                for (const auto& [coords, value] : uncompressed_data) {
+                    norms[coords[1]] += std::abs(value);
+                }
+                // Take maximum
+                norm_value = *std::max_element(norms.begin(), norms.end(),complexLess<double> );
+
+            } else if constexpr (N == NormType::Infinity) {
+                // Infinity-norm computation for uncompressed matrix, row ordering
+                T row_sum{0};
+                for (std::size_t i = 0; i < numrows; ++i) {
+                    row_sum = 0;
+                    // Take row i
+                    auto start = uncompressed_data.lower_bound({i, 0});
+                    auto end = uncompressed_data.upper_bound({i, std::numeric_limits<std::size_t>::max()});
+                    for (auto it = start ; it!= end; ++it){
+                    auto coords = it->first;
+                    T value = it->second;
+                    row_sum += std::abs(value);
+                    }
+                    norm_value = std::max(norm_value, row_sum, complexLess<double>);
+                }
+            }
+
+        } else if constexpr (Order == StorageOrder::ColumnOrdering) {
+            // Column ordering in uncompressed format
+            if constexpr (N == NormType::One) {
+                // One - norm computation for uncompressed matrix, column ordering
+                for (std::size_t j = 0; j < numcols; ++j) {
+                        T col_sum = 0;
+                        auto start = uncompressed_data.lower_bound({0, j});
+                        auto end = uncompressed_data.upper_bound({std::numeric_limits<std::size_t>::max(), j});
+                        for (auto it = start ; it!= end; ++it){
+                        auto coords = it->first;
+                        T value = it->second;
+                        col_sum += std::abs(value);
+                        }
+                        norm_value = std::max(norm_value, col_sum, complexLess<double>);
+                }
+
+            } else if constexpr (N == NormType::Infinity) {
+                // Infinity-norm computation for uncompressed matrix, row ordering
+                std::vector<T> norms(numrows, 0);
+                for (const auto& [coords, value] : uncompressed_data) {
+                    norms[coords[0]] += std::abs(value);
+                }
+                norm_value = *std::max_element(norms.begin(), norms.end(), complexLess<double>);
+                } 
+            }
+        }
+        return norm_value;
+    }
+
+} // namespace algebra
+
+#endif // SPARSE_MATRIX_IMPL_HPP
@@ -9,6 +9,9 @@
 #include<complex>
 #include <iostream>
 #include <type_traits>
+#include <concepts>
+#include <cstddef>
+#include <span>
 
 namespace algebra{
     /**
@@ -36,6 +39,20 @@ namespace algebra{
     template<typename T>
     concept RealOrComplex = Numeric<T> || Complex<T>;
 
+    /**
+     * @brief Concept to check if a type is a linear operator on vectors of T: it knows its dimensions and
+     * computes y = A x into an existing vector with apply(x, y), x and y being spans of cols() and rows() entries.
+     * Matrix, MatrixView, BlockOperator, KroneckerOperator and matrix-free kernels written by the user satisfy it.
+     * @tparam Op Type to check.
+     * @tparam T Type of the entries of the vectors.
+     */
+    template<typename Op, typename T>
+    concept LinearOperator = RealOrComplex<T> && requires(const Op& op, std::span<const T> x, std::span<T> y) {
+        { op.rows() } -> std::convertible_to<std::size_t>;
+        { op.cols() } -> std::convertible_to<std::size_t>;
+        op.apply(x, y);
+    };
+
 } // namespace algebra
 
 #endif /* SparseMatrixTraits_HPP */
\ No newline at end of file
@@ -0,0 +1,619 @@
+/**
+ * @file spmv_bench.cpp
+ * @brief Benchmarks of the sparse matrix kernels.
+ *
+ * Usage:
+ * ```
+ * ./spmv_bench tlb [rows] [non zeros per row] [repetitions]
+ * ./spmv_bench multi [rows] [non zeros per row] [matrices] [repetitions]
+ * ./spmv_bench dictionary [rows] [non zeros per row] [repetitions]
+ * ./spmv_bench precision [rows] [non zeros per row] [repetitions]
+ * ./spmv_bench lookup [rows] [non zeros per row] [lookups]
+ * ./spmv_bench batched [items] [rows] [repetitions]
+ * ./spmv_bench server [file.mtx] [repetitions]
+ * ```
+ * tlb: SpMV with a random sparse matrix whose compressed arrays (and vectors) are allocated with regular pages
+ * and with huge pages (HugePageResource); reports the time and, when the hardware counters are accessible
+ * (perf_event_open), the data TLB misses of each variant.
+ *
+ * multi: products of several matrices sharing one sparsity pattern, computed with one operator* per matrix
+ * and with the single-pass kernel compressed_multiply_multi.
+ *
+ * dictionary: SpMV with plain values, with dictionary encoded values (the random matrix has 7 distinct values)
+ * and with the pattern only.
+ *
+ * precision: SpMV with the same random matrix stored in float, double, long double, int and std::complex<float>.
+ *
+ * lookup: time per element access (const and non-const call operator) on a compressed matrix; compare the default
+ * build with make HEADER_ONLY=1, where the accesses can be inlined.
+ *
+ * batched: many small diagonally dominant systems with a common pattern, as separate Matrix objects (one SpMV and
+ * one GMRES solve per item) and as a BatchedMatrix (batched SpMV, BatchedLU, bicgstab_batched).
+ *
+ * server: starts spmv_server (from the directory of spmv_bench) on a matrix file, checks the replies of a Client
+ * against Matrix::operator* (single, pipelined dependent and in-place products, norms, a refused Hello) and
+ * measures the round trip of a blocking Multiply and of a pipelined group of independent ones.
+ */
+
+#include "sparse_matrix.hpp"
+#include "batched_matrix.hpp"
+#include "spmv_protocol.hpp"
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <csignal>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+    /**
+     * @brief Counter of data TLB load misses of the calling thread (user space only)
+     */
+    class TlbMissCounter {
+    public:
+        TlbMissCounter(){
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+        ~TlbMissCounter(){
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        bool available() const{ return fd >= 0;};
+
+        void start(){
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        long long stop(){
+            long long count = -1;
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fd, &count, sizeof(count)) != sizeof(count)) {
+                    count = -1;
+                }
+            }
+            return count;
+        }
+
+    private:
+        int fd = -1;
+    };
+
+    // Random sparse matrix with nnz_per_row entries per row, stored with the given resource
+    template<algebra::RealOrComplex T = double>
+    algebra::Matrix<T, algebra::StorageOrder::RowOrdering> random_matrix(std::size_t n, std::size_t nnz_per_row,
+                                                                         std::pmr::memory_resource* resource){
+        std::mt19937_64 gen(42);
+        std::uniform_int_distribution<std::size_t> column(0, n - 1);
+        std::pmr::vector<std::size_t> inner(resource), outer(resource);
+        std::pmr::vector<T> data(resource);
+        inner.reserve(n + 1);
+        outer.reserve(n * nnz_per_row);
+        data.reserve(n * nnz_per_row);
+        inner.push_back(0);
+        std::vector<std::size_t> row(nnz_per_row);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (auto& j : row) {
+                j = column(gen);
+            }
+            std::sort(row.begin(), row.end());
+            row.erase(std::unique(row.begin(), row.end()), row.end());
+            for (std::size_t j : row) {
+                outer.push_back(j);
+                data.push_back(static_cast<T>(1.0 / (1.0 + static_cast<double>(j % 7))));
+            }
+            row.resize(nnz_per_row);
+            inner.push_back(outer.size());
+        }
+        return algebra::Matrix<T, algebra::StorageOrder::RowOrdering>(n, n, std::move(inner), std::move(outer), std::move(data));
+    }
+
+    // SpMV with regular pages and with huge pages
+    int tlb_benchmark(std::size_t n, std::size_t nnz_per_row, int repetitions){
+        std::cout << "SpMV, " << n << " rows, " << nnz_per_row << " non zeros per row, " << repetitions << " repetitions" << std::endl;
+        TlbMissCounter counter;
+        if (!counter.available()) {
+            std::cout << "(dTLB counters not available: check /proc/sys/kernel/perf_event_paranoid; only times are reported)" << std::endl;
+        }
+        algebra::HugePageResource regular(algebra::HugePages::None);
+        struct Variant { const char* name; std::pmr::memory_resource* resource; };
+        const Variant variants[] = {{"regular pages", &regular}, {"huge pages   ", &algebra::huge_page_resource()}};
+        for (const auto& variant : variants) {
+            auto A = random_matrix(n, nnz_per_row, variant.resource);
+            std::pmr::vector<double> x(n, 1.0, variant.resource), y(n, 0.0, variant.resource);
+            // Warm up: touch all the pages
+            algebra::compressed_multiply<double, algebra::StorageOrder::RowOrdering>(A.inner_index(), A.outer_index(), A.values(), x, y);
+
+            counter.start();
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < repetitions; ++r) {
+                std::fill(y.begin(), y.end(), 0.0);
+                algebra::compressed_multiply<double, algebra::StorageOrder::RowOrdering>(A.inner_index(), A.outer_index(), A.values(), x, y);
+            }
+            auto t1 = std::chrono::high_resolution_clock::now();
+            const long long misses = counter.stop();
+
+            std::cout << variant.name << ": " << std::chrono::duration<double, std::milli>(t1 - t0).count() / repetitions
+                      << " ms per SpMV";
+            if (misses >= 0) {
+                std::cout << ", " << static_cast<double>(misses) / repetitions << " dTLB misses per SpMV";
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+
+    // Products of several matrices with the same pattern: one SpMV per matrix against one pass over the pattern
+    int multi_benchmark(std::size_t n, std::size_t nnz_per_row, std::size_t nmat, int repetitions){
+        using Matrix = algebra::Matrix<double, algebra::StorageOrder::RowOrdering>;
+        std::cout << nmat << " matrices with the same pattern, " << n << " rows, " << nnz_per_row << " non zeros per row, "
+                  << repetitions << " repetitions" << std::endl;
+        const Matrix A = random_matrix(n, nnz_per_row, std::pmr::get_default_resource());
+        std::vector<Matrix> matrices;
+        std::vector<const Matrix*> pointers;
+        matrices.reserve(nmat);
+        for (std::size_t m = 0; m < nmat; ++m) {
+            matrices.emplace_back(A.pattern(), 1.0 + static_cast<double>(m));
+            pointers.push_back(&matrices.back());
+        }
+        const std::vector<double> x(n, 1.0);
+
+        // The two variants alternate and the best sweep of each is reported, which is stable on a busy machine
+        double checksum_separate = 0, checksum_multi = 0;
+        double best_separate = std::numeric_limits<double>::max(), best_multi = std::numeric_limits<double>::max();
+        for (int r = 0; r < repetitions; ++r) {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (const auto& M : matrices) {
+                checksum_separate += (M * x)[n / 2];
+            }
+            auto t1 = std::chrono::high_resolution_clock::now();
+            for (const auto& y : algebra::multiply_shared(pointers, x)) {
+                checksum_multi += y[n / 2];
+            }
+            auto t2 = std::chrono::high_resolution_clock::now();
+            best_separate = std::min(best_separate, std::chrono::duration<double, std::milli>(t1 - t0).count());
+            best_multi = std::min(best_multi, std::chrono::duration<double, std::milli>(t2 - t1).count());
+        }
+
+        std::cout << "separate products: " << best_separate << " ms per sweep (best of " << repetitions << ")" << std::endl;
+        std::cout << "single pass      : " << best_multi << " ms per sweep (best of " << repetitions << ")" << std::endl;
+        // the single pass may group the sums differently: compare within a tolerance
+        return std::abs(checksum_separate - checksum_multi) <= 1e-12 * std::max(std::abs(checksum_separate), 1.0) ? 0 : 1;
+    }
+
+    // SpMV with plain, dictionary encoded and pattern-only values
+    int dictionary_benchmark(std::size_t n, std::size_t nnz_per_row, int repetitions){
+        using Matrix = algebra::Matrix<double, algebra::StorageOrder::RowOrdering>;
+        std::cout << "SpMV, " << n << " rows, " << nnz_per_row << " non zeros per row, " << repetitions << " repetitions" << std::endl;
+        const Matrix plain = random_matrix(n, nnz_per_row, std::pmr::get_default_resource());
+        Matrix dictionary = plain;
+        dictionary.encode(algebra::ValueEncoding::Automatic);
+        Matrix pattern(plain.pattern(), 1.0);
+        pattern.encode(algebra::ValueEncoding::Pattern);
+        const std::vector<double> x(n, 1.0);
+
+        struct Variant { const char* name; const Matrix* matrix; };
+        const Variant variants[] = {{"plain values     ", &plain}, {"8 bit codes      ", &dictionary}, {"pattern only     ", &pattern}};
+        for (const auto& variant : variants) {
+            double checksum = 0;
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < repetitions; ++r) {
+                checksum += ((*variant.matrix) * x)[n / 2];
+            }
+            auto t1 = std::chrono::high_resolution_clock::now();
+            std::cout << variant.name << ": " << std::chrono::duration<double, std::milli>(t1 - t0).count() / repetitions
+                      << " ms per SpMV (checksum " << checksum << ")" << std::endl;
+        }
+        return 0;
+    }
+
+    // SpMV with values and vectors of type T
+    template<algebra::RealOrComplex T>
+    void precision_run(const char* name, std::size_t n, std::size_t nnz_per_row, int repetitions){
+        const auto A = random_matrix<T>(n, nnz_per_row, std::pmr::get_default_resource());
+        const std::vector<T> x(n, T{1});
+        T checksum{0};
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            checksum += (A * x)[n / 2];
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        std::cout << name << ": " << std::chrono::duration<double, std::milli>(t1 - t0).count() / repetitions
+                  << " ms per SpMV (checksum " << checksum << ")" << std::endl;
+    }
+
+    // SpMV with the element types supported by the library
+    int precision_benchmark(std::size_t n, std::size_t nnz_per_row, int repetitions){
+        std::cout << "SpMV, " << n << " rows, " << nnz_per_row << " non zeros per row, " << repetitions << " repetitions" << std::endl;
+        precision_run<float>("float              ", n, nnz_per_row, repetitions);
+        precision_run<double>("double             ", n, nnz_per_row, repetitions);
+        precision_run<long double>("long double        ", n, nnz_per_row, repetitions);
+        precision_run<int>("int                ", n, nnz_per_row, repetitions);
+        precision_run<std::complex<float>>("std::complex<float>", n, nnz_per_row, repetitions);
+        return 0;
+    }
+
+    // Element access at random positions of the stored elements
+    int lookup_benchmark(std::size_t n, std::size_t nnz_per_row, std::size_t lookups){
+        using Matrix = algebra::Matrix<double, algebra::StorageOrder::RowOrdering>;
+#ifdef ALGEBRA_HEADER_ONLY
+        std::cout << "Header-only build, ";
+#else
+        std::cout << "Explicit instantiation build, ";
+#endif
+        std::cout << lookups << " lookups in a matrix with " << n << " rows, " << nnz_per_row << " non zeros per row" << std::endl;
+        Matrix A = random_matrix(n, nnz_per_row, std::pmr::get_default_resource());
+        const Matrix& const_A = A;
+        auto inner = A.inner_index();
+        auto outer = A.outer_index();
+        std::mt19937_64 gen(7);
+        std::uniform_int_distribution<std::size_t> row(0, n - 1);
+        std::vector<std::pair<std::size_t, std::size_t>> positions(lookups);
+        for (auto& [i, j] : positions) {
+            i = row(gen);
+            j = outer[inner[i] + gen() % (inner[i + 1] - inner[i])];
+        }
+
+        double sum = 0;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (const auto& [i, j] : positions) {
+            sum += const_A(i, j);
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (const auto& [i, j] : positions) {
+            A(i, j) *= 1.0;
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::cout << "const access    : " << std::chrono::duration<double, std::nano>(t1 - t0).count() / lookups << " ns per lookup"
+                  << " (checksum " << sum << ")" << std::endl;
+        std::cout << "non-const access: " << std::chrono::duration<double, std::nano>(t2 - t1).count() / lookups << " ns per lookup" << std::endl;
+        return 0;
+    }
+
+    // Small diagonally dominant matrices with a common pattern: tridiagonal plus a coupling with row i + 3
+    std::vector<algebra::Matrix<double, algebra::StorageOrder::RowOrdering>> small_systems(std::size_t items, std::size_t n){
+        algebra::Matrix<double, algebra::StorageOrder::RowOrdering> first(n, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            first(i, i) = 1.0;
+            if (i + 3 < n) {
+                first(i, i + 3) = 1.0;
+            }
+            if (i > 0) {
+                first(i, i - 1) = 1.0;
+            }
+            if (i + 1 < n) {
+                first(i, i + 1) = 1.0;
+            }
+        }
+        first.compress();
+        std::mt19937_64 gen(3);
+        std::uniform_real_distribution<double> coupling(-1.0, 0.0);
+        std::vector<algebra::Matrix<double, algebra::StorageOrder::RowOrdering>> systems;
+        systems.reserve(items);
+        auto inner = first.inner_index();
+        auto outer = first.outer_index();
+        for (std::size_t b = 0; b < items; ++b) {
+            systems.emplace_back(first.pattern(), 0.0);
+            auto values = systems.back().values();
+            for (std::size_t i = 0; i < n; ++i) {
+                double off_diagonal = 0;
+                std::size_t diagonal = 0;
+                for (std::size_t k = inner[i]; k < inner[i + 1]; ++k) {
+                    if (outer[k] == i) {
+                        diagonal = k;
+                    } else {
+                        values[k] = coupling(gen);
+                        off_diagonal -= values[k];
+                    }
+                }
+                values[diagonal] = off_diagonal + 1.0 + static_cast<double>(b % 3);
+            }
+        }
+        return systems;
+    }
+
+    // Separate matrices against a batch
+    int batched_benchmark(std::size_t items, std::size_t n, int repetitions){
+        std::cout << items << " systems with " << n << " rows, " << repetitions << " repetitions" << std::endl;
+        auto systems = small_systems(items, n);
+        algebra::BatchedMatrix<double> batch(systems);
+        std::vector<double> ones(n, 1.0), rhs(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            rhs[i] = 1.0 + static_cast<double>(i % 5);
+        }
+        std::vector<double> packed_ones(n * items, 1.0), packed_y(n * items);
+        std::vector<double> packed_rhs = algebra::pack_batch(std::vector<std::vector<double>>(items, rhs));
+
+        auto t0 = std::chrono::high_resolution_clock::now();
+        double checksum = 0;
+        for (int r = 0; r < repetitions; ++r) {
+            for (const auto& A : systems) {
+                checksum += (A * ones)[0];
+            }
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            batch.multiply(packed_ones, packed_y);
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::cout << "SpMV, one Matrix per item: " << std::chrono::duration<double, std::milli>(t1 - t0).count() / repetitions
+                  << " ms (checksum " << checksum << ")" << std::endl;
+        std::cout << "SpMV, BatchedMatrix      : " << std::chrono::duration<double, std::milli>(t2 - t1).count() / repetitions
+                  << " ms" << std::endl;
+
+        std::size_t iterations = 0;
+        t0 = std::chrono::high_resolution_clock::now();
+        for (const auto& A : systems) {
+            std::vector<double> x;
+            iterations += algebra::gmres(A, rhs, x, 1e-10).iterations;
+        }
+        t1 = std::chrono::high_resolution_clock::now();
+        algebra::BatchedLU<double> lu(batch);
+        auto x_lu = lu.solve(packed_rhs);
+        t2 = std::chrono::high_resolution_clock::now();
+        std::vector<double> x_krylov(n * items, 0.0);
+        auto results = algebra::bicgstab_batched<double>(batch, packed_rhs, x_krylov, 1e-10);
+        auto t3 = std::chrono::high_resolution_clock::now();
+        std::size_t batched_iterations = 0;
+        for (const auto& result : results) {
+            batched_iterations = std::max(batched_iterations, result.iterations);
+        }
+        std::cout << "Solve, GMRES per item    : " << std::chrono::duration<double, std::milli>(t1 - t0).count()
+                  << " ms (" << static_cast<double>(iterations) / items << " iterations per item)" << std::endl;
+        std::cout << "Solve, BatchedLU         : " << std::chrono::duration<double, std::milli>(t2 - t1).count()
+                  << " ms (" << lu.nonzeros() << " entries in the factors of each item)" << std::endl;
+        std::cout << "Solve, bicgstab_batched  : " << std::chrono::duration<double, std::milli>(t3 - t2).count()
+                  << " ms (at most " << batched_iterations << " iterations)" << std::endl;
+        return 0;
+    }
+
+    // Largest absolute difference between a vector in the client buffer and a reference
+    double max_difference(std::span<const double> computed, const std::vector<double>& expected){
+        double difference = 0;
+        for (std::size_t i = 0; i < expected.size(); ++i) {
+            difference = std::max(difference, std::abs(computed[i] - expected[i]));
+        }
+        return difference;
+    }
+
+    // Round trips with the SpMV service, checked against Matrix::operator*
+    int server_benchmark(const std::string& server_path, const std::string& file, int repetitions){
+        using namespace algebra::spmv_service;
+        algebra::Matrix<double, algebra::StorageOrder::RowOrdering> A(0, 0);
+        A.read(file);
+        A.compress();
+        const std::size_t n = A.cols(), m = A.rows();
+        if (n != m) {
+            std::cerr << "The matrix must be square." << std::endl;
+            return 1;
+        }
+
+        const std::string socket_path = "/tmp/spmv_bench_" + std::to_string(getpid()) + ".sock";
+        const pid_t server = fork();
+        if (server == 0) {
+            const std::string spec = "A=" + file;
+            execl(server_path.c_str(), server_path.c_str(), socket_path.c_str(), spec.c_str(), static_cast<char*>(nullptr));
+            std::perror("Cannot start spmv_server");
+            _exit(1);
+        }
+        auto stop_server = [&]{
+            kill(server, SIGTERM);
+            waitpid(server, nullptr, 0);
+        };
+
+        // The server needs some time to read the matrix and listen
+        std::unique_ptr<Client> client;
+        for (int attempt = 0; attempt < 100 && !client; ++attempt) {
+            try {
+                client = std::make_unique<Client>(socket_path, 8 * n);
+            } catch (const std::runtime_error&) {
+                usleep(50000);
+            }
+        }
+        if (!client) {
+            std::cerr << "Cannot connect to spmv_server at " << socket_path << std::endl;
+            stop_server();
+            return 1;
+        }
+
+        bool all_passed = true;
+        auto report = [&](const std::string& what, bool passed){
+            std::cout << what << ": " << (passed ? "ok" : "FAILED") << std::endl;
+            all_passed = all_passed && passed;
+        };
+        const double tolerance = 1e-12 * A.norm<algebra::NormType::Infinity>();
+        const std::uint32_t id = client->lookup("A").matrix;
+        auto buffer = client->data();
+        std::vector<double> x = algebra::generateRandomVector(A);
+        std::copy(x.begin(), x.end(), buffer.begin());
+        std::vector<double> y = A * x, z = A * y;
+
+        // Slots of the buffer: x at 0, y at n, z at 2n
+        client->multiply(id, 0, n);
+        report("Multiply", max_difference(buffer.subspan(n, n), y) <= tolerance);
+        // The two requests reach the server in the same round only some of the time: repeat them
+        bool pipelined = true;
+        for (int r = 0; r < 1000; ++r) {
+            std::fill(buffer.begin() + n, buffer.begin() + 3 * n, 0.0);
+            client->submit_multiply(id, 0, n);
+            client->submit_multiply(id, n, 2 * n);
+            const bool answered = client->receive().status == 0 && client->receive().status == 0;
+            pipelined = pipelined && answered && max_difference(buffer.subspan(n, n), y) <= tolerance
+                                  && max_difference(buffer.subspan(2 * n, n), z) <= tolerance;
+        }
+        report("Pipelined y = A*x; z = A*y", pipelined);
+        std::copy(x.begin(), x.end(), buffer.begin() + 3 * n);
+        client->multiply(id, 3 * n, 3 * n);
+        report("In place x = A*x", max_difference(buffer.subspan(3 * n, n), y) <= tolerance);
+        report("Norms", std::abs(client->norm(id, 0) - A.norm<algebra::NormType::One>()) <= tolerance
+                        && std::abs(client->norm(id, 2) - A.norm<algebra::NormType::Frobenius>()) <= tolerance);
+        Request bad_norm;
+        bad_norm.operation = static_cast<std::uint32_t>(Operation::Norm);
+        bad_norm.matrix = id;
+        bad_norm.parameter = 3;
+        client->send(bad_norm);
+        report("Norm 3 refused", client->receive().status == static_cast<std::int32_t>(Status::BadRequest));
+        report("Solve 2 refused", client->solve(id, 0, n, 2).status == static_cast<std::int32_t>(Status::BadRequest));
+
+        // A client sending many requests before reading any reply gets them all, in order, even when they do not fit
+        // in the socket buffer; the receive timeout turns a lost reply into a failure instead of a hang
+        {
+            int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            timeval timeout{5, 0};
+            const int requests = 20000;
+            Request norm;
+            norm.operation = static_cast<std::uint32_t>(Operation::Norm);
+            norm.matrix = id;
+            bool sent = sock >= 0 && setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0
+                     && connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+            for (int r = 0; r < requests && sent; ++r) {
+                norm.parameter = r % 3;
+                sent = send(sock, &norm, sizeof(norm), 0) == sizeof(norm);
+            }
+            const double norms[3] = {client->norm(id, 0), client->norm(id, 1), client->norm(id, 2)};
+            int received = 0;
+            Reply reply;
+            while (sent && received < requests && recv(sock, &reply, sizeof(reply), 0) == sizeof(reply)
+                   && reply.status == 0 && reply.value == norms[received % 3]) {
+                ++received;
+            }
+            if (sock >= 0) {
+                close(sock);
+            }
+            report(std::to_string(requests) + " requests before the first reply", received == requests);
+        }
+
+        // A Hello claiming more bytes than the segment has must be refused, and the server must survive it
+        {
+            const std::string small = "/spmv_bench_small_" + std::to_string(getpid());
+            int fd = shm_open(small.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            const bool created = fd >= 0 && ftruncate(fd, 4096) == 0;
+            if (fd >= 0) {
+                close(fd);
+            }
+            int sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            Request hello;
+            hello.operation = static_cast<std::uint32_t>(Operation::Hello);
+            hello.size = 64 << 20;
+            std::strncpy(hello.name, small.c_str(), sizeof(hello.name) - 1);
+            Reply reply;
+            const bool refused = created && connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0
+                              && send(sock, &hello, sizeof(hello), 0) == sizeof(hello)
+                              && recv(sock, &reply, sizeof(reply), 0) == sizeof(reply)
+                              && reply.status == static_cast<std::int32_t>(Status::BadRequest);
+            close(sock);
+            shm_unlink(small.c_str());
+            client->multiply(id, 0, n);
+            report("Oversized Hello refused", refused && max_difference(buffer.subspan(n, n), y) <= tolerance);
+        }
+
+        // Round trips: one blocking Multiply at a time, then groups of 4 independent ones sent together
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            client->multiply(id, 0, n);
+        }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repetitions; ++r) {
+            for (std::size_t v = 1; v <= 4; ++v) {
+                client->submit_multiply(id, 0, v * n);
+            }
+            for (std::size_t v = 1; v <= 4; ++v) {
+                all_passed = client->receive().status == 0 && all_passed;
+            }
+        }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        std::cout << "Matrix " << file << " (" << n << " rows, " << A.nonzeros() << " non zeros), " << repetitions << " repetitions" << std::endl;
+        std::cout << "Round trip, blocking Multiply     : "
+                  << std::chrono::duration<double, std::micro>(t1 - t0).count() / repetitions << " us" << std::endl;
+        std::cout << "Round trip, 4 pipelined Multiplies: "
+                  << std::chrono::duration<double, std::micro>(t2 - t1).count() / repetitions << " us" << std::endl;
+
+        client.reset();
+        stop_server();
+        return all_passed ? 0 : 1;
+    }
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+    const std::string mode = argc > 1 ? argv[1] : "";
+    if (mode == "tlb") {
+        const std::size_t n = argc > 2 ? std::stoul(argv[2]) : 4000000;
+        const std::size_t nnz_per_row = argc > 3 ? std::stoul(argv[3]) : 16;
+        const int repetitions = argc > 4 ? std::stoi(argv[4]) : 10;
+        return tlb_benchmark(n, nnz_per_row, repetitions);
+    }
+    if (mode == "multi") {
+        const std::size_t n = argc > 2 ? std::stoul(argv[2]) : 1000000;
+        const std::size_t nnz_per_row = argc > 3 ? std::stoul(argv[3]) : 16;
+        const std::size_t nmat = argc > 4 ? std::stoul(argv[4]) : 4;
+        const int repetitions = argc > 5 ? std::stoi(argv[5]) : 10;
+        return multi_benchmark(n, nnz_per_row, nmat, repetitions);
+    }
+    if (mode == "dictionary") {
+        const std::size_t n = argc > 2 ? std::stoul(argv[2]) : 2000000;
+        const std::size_t nnz_per_row = argc > 3 ? std::stoul(argv[3]) : 16;
+        const int repetitions = argc > 4 ? std::stoi(argv[4]) : 10;
+        return dictionary_benchmark(n, nnz_per_row, repetitions);
+    }
+    if (mode == "precision") {
+        const std::size_t n = argc > 2 ? std::stoul(argv[2]) : 2000000;
+        const std::size_t nnz_per_row = argc > 3 ? std::stoul(argv[3]) : 16;
+        const int repetitions = argc > 4 ? std::stoi(argv[4]) : 10;
+        return precision_benchmark(n, nnz_per_row, repetitions);
+    }
+    if (mode == "lookup") {
+        const std::size_t n = argc > 2 ? std::stoul(argv[2]) : 100000;
+        const std::size_t nnz_per_row = argc > 3 ? std::stoul(argv[3]) : 16;
+        const std::size_t lookups = argc > 4 ? std::stoul(argv[4]) : 10000000;
+        return lookup_benchmark(n, nnz_per_row, lookups);
+    }
+    if (mode == "batched") {
+        const std::size_t items = argc > 2 ? std::stoul(argv[2]) : 100000;
+        const std::size_t n = argc > 3 ? std::stoul(argv[3]) : 50;
+        const int repetitions = argc > 4 ? std::stoi(argv[4]) : 10;
+        return batched_benchmark(items, n, repetitions);
+    }
+    if (mode == "server") {
+        const std::string self = argv[0];
+        const auto slash = self.rfind('/');
+        const std::string server_path = (slash == std::string::npos ? std::string(".") : self.substr(0, slash)) + "/spmv_server";
+        const std::string file = argc > 2 ? argv[2] : "lnsp_131.mtx";
+        const int repetitions = argc > 3 ? std::stoi(argv[3]) : 10000;
+        return server_benchmark(server_path, file, repetitions);
+    }
+    std::cerr << "Usage: " << argv[0] << " tlb [rows] [non zeros per row] [repetitions]" << std::endl;
+    std::cerr << "       " << argv[0] << " multi [rows] [non zeros per row] [matrices] [repetitions]" << std::endl;
+    std::cerr << "       " << argv[0] << " dictionary [rows] [non zeros per row] [repetitions]" << std::endl;
+    std::cerr << "       " << argv[0] << " precision [rows] [non zeros per row] [repetitions]" << std::endl;
+    std::cerr << "       " << argv[0] << " lookup [rows] [non zeros per row] [lookups]" << std::endl;
+    std::cerr << "       " << argv[0] << " batched [items] [rows] [repetitions]" << std::endl;
+    std::cerr << "       " << argv[0] << " server [file.mtx] [repetitions]" << std::endl;
+    return 1;
+}
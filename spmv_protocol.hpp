@@ -0,0 +1,268 @@
+/**
+ * @file spmv_protocol.hpp
+ * @brief Contains the wire format of the SpMV service (spmv_server) and a C++ client.
+ *
+ * The server listens on a Unix domain socket of type SOCK_SEQPACKET: every message is exactly one
+ * Request (client to server) or one Reply (server to client), in native byte order. Both are plain
+ * structs with fixed-width fields, so clients can be written in any language.
+ *
+ * Vectors never travel through the socket: the client creates a POSIX shared memory segment of doubles,
+ * sends its name with a Hello request and refers to vectors by their offset (in doubles) in that buffer.
+ * A typical session is Hello, Lookup (name to id), then any number of Multiply / Norm / Solve requests.
+ * The client may send several requests before reading the replies: the server batches the independent Multiply
+ * requests received together on the same matrix into a single SpMM, and a request that uses the result of an
+ * earlier one sees it. Replies of a client come in order, and none is lost if the client reads them late: the server
+ * queues the replies that do not fit in the socket buffer.
+ */
+
+#ifndef SPMV_PROTOCOL_HPP
+#define SPMV_PROTOCOL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <span>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace algebra::spmv_service {
+
+    /**
+     * @brief Operations understood by the server
+     */
+    enum class Operation : std::uint32_t {
+        Hello = 1,    //!< name: shared memory segment of the client, size: its size in bytes (at most the segment size)
+        Lookup = 2,   //!< name: matrix name; the reply contains its id and dimensions
+        Multiply = 3, //!< output = A*input (the two vectors may overlap)
+        Norm = 4,     //!< parameter: 0 One, 1 Infinity, 2 Frobenius (BadRequest otherwise); the reply contains the value
+        Solve = 5     //!< solves A*output = input (output holds the initial guess); parameter: 0 CG, 1 GMRES (BadRequest otherwise)
+    };
+
+    /**
+     * @brief Status of a reply
+     */
+    enum class Status : std::int32_t {
+        Ok = 0,
+        BadRequest = -1,    //!< unknown operation or malformed request
+        UnknownMatrix = -2, //!< no matrix with this name or id
+        OutOfBuffer = -3,   //!< vectors do not fit in the client buffer (or no buffer was registered)
+        NotConverged = -4   //!< the solver reached the maximum number of iterations
+    };
+
+    /**
+     * @brief A request (one message)
+     */
+    struct Request {
+        std::uint32_t operation = 0; //!< one of Operation
+        std::uint32_t matrix = 0; //!< id of the matrix
+        std::uint64_t input = 0; //!< offset of the input vector in the client buffer (in doubles)
+        std::uint64_t output = 0; //!< offset of the output vector in the client buffer (in doubles)
+        std::uint64_t size = 0; //!< size in bytes of the client buffer (Hello)
+        double tolerance = 1e-10; //!< tolerance of the solver (Solve)
+        std::uint32_t max_iterations = 1000; //!< maximum number of iterations (Solve)
+        std::uint32_t parameter = 0; //!< type of norm (Norm) or solver (Solve)
+        char name[64] = {}; //!< segment name (Hello) or matrix name (Lookup), null terminated
+    };
+
+    /**
+     * @brief A reply (one message)
+     */
+    struct Reply {
+        std::int32_t status = 0; //!< one of Status
+        std::uint32_t matrix = 0; //!< id of the matrix (Lookup)
+        std::uint64_t rows = 0; //!< number of rows (Lookup)
+        std::uint64_t cols = 0; //!< number of columns (Lookup)
+        std::uint64_t iterations = 0; //!< iterations of the solver (Solve)
+        double value = 0; //!< norm (Norm) or final relative residual (Solve)
+    };
+
+    static_assert(sizeof(Request) == 112 && sizeof(Reply) == 40, "Unexpected padding in the wire format");
+
+
+    /**
+     * @brief Minimal C++ client of the SpMV service
+     */
+    class Client {
+    public:
+        /**
+         * @brief Connects to the server and registers a shared buffer of the given number of doubles
+         *
+         * @param socket_path Path of the server socket
+         * @param buffer_size Number of doubles of the shared buffer
+         */
+        Client(const std::string& socket_path, std::size_t buffer_size){
+            // Create the shared buffer: the name is removed as soon as the server has mapped it
+            static int counter = 0;
+            const std::string shm_name = "/spmv_client_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+            length = buffer_size * sizeof(double);
+            int fd = shm_open(shm_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0 || ftruncate(fd, static_cast<off_t>(length)) != 0) {
+                if (fd >= 0) {
+                    close(fd);
+                    shm_unlink(shm_name.c_str());
+                }
+                throw std::runtime_error("Client: cannot create the shared buffer.");
+            }
+            void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (ptr == MAP_FAILED) {
+                shm_unlink(shm_name.c_str());
+                throw std::runtime_error("Client: cannot map the shared buffer.");
+            }
+            buffer = static_cast<double*>(ptr);
+
+            sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            if (sock < 0 || connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                shm_unlink(shm_name.c_str());
+                munmap(buffer, length);
+                if (sock >= 0) {
+                    close(sock);
+                }
+                throw std::runtime_error("Client: cannot connect to " + socket_path);
+            }
+
+            Request request;
+            request.operation = static_cast<std::uint32_t>(Operation::Hello);
+            request.size = length;
+            std::strncpy(request.name, shm_name.c_str(), sizeof(request.name) - 1);
+            send(request);
+            Reply reply;
+            const bool answered = recv(sock, &reply, sizeof(reply), 0) == static_cast<ssize_t>(sizeof(reply));
+            shm_unlink(shm_name.c_str());
+            if (!answered || reply.status != static_cast<std::int32_t>(Status::Ok)) {
+                close(sock);
+                munmap(buffer, length);
+                throw std::runtime_error("Client: the server refused the shared buffer.");
+            }
+        }
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        ~Client(){
+            if (sock >= 0) {
+                close(sock);
+            }
+            if (buffer != nullptr) {
+                munmap(buffer, length);
+            }
+        }
+
+        /**
+         * @brief The shared buffer, where input and output vectors are stored
+         */
+        std::span<double> data(){ return {buffer, length / sizeof(double)};};
+
+        /**
+         * @brief Looks up a matrix by name
+         *
+         * @return Reply The id and the dimensions of the matrix
+         */
+        Reply lookup(const std::string& matrix_name){
+            Request request;
+            request.operation = static_cast<std::uint32_t>(Operation::Lookup);
+            std::strncpy(request.name, matrix_name.c_str(), sizeof(request.name) - 1);
+            Reply reply = call(request);
+            check(reply, "Lookup");
+            return reply;
+        }
+
+        /**
+         * @brief Computes data()[output...] = A * data()[input...]
+         */
+        void multiply(std::uint32_t matrix, std::uint64_t input, std::uint64_t output){
+            submit_multiply(matrix, input, output);
+            check(receive(), "Multiply");
+        }
+
+        /**
+         * @brief Sends a Multiply request without waiting: the reply must be read with receive()
+         */
+        void submit_multiply(std::uint32_t matrix, std::uint64_t input, std::uint64_t output){
+            Request request;
+            request.operation = static_cast<std::uint32_t>(Operation::Multiply);
+            request.matrix = matrix;
+            request.input = input;
+            request.output = output;
+            send(request);
+        }
+
+        /**
+         * @brief Computes a norm of the matrix (0 One, 1 Infinity, 2 Frobenius)
+         */
+        double norm(std::uint32_t matrix, std::uint32_t type){
+            Request request;
+            request.operation = static_cast<std::uint32_t>(Operation::Norm);
+            request.matrix = matrix;
+            request.parameter = type;
+            Reply reply = call(request);
+            check(reply, "Norm");
+            return reply.value;
+        }
+
+        /**
+         * @brief Solves A*x = b, with b at offset input and x (initial guess and solution) at offset output
+         *
+         * @param method 0 CG, 1 GMRES
+         * @return Reply Status, iterations and final relative residual
+         */
+        Reply solve(std::uint32_t matrix, std::uint64_t input, std::uint64_t output, std::uint32_t method,
+                    double tolerance = 1e-10, std::uint32_t max_iterations = 1000){
+            Request request;
+            request.operation = static_cast<std::uint32_t>(Operation::Solve);
+            request.matrix = matrix;
+            request.input = input;
+            request.output = output;
+            request.parameter = method;
+            request.tolerance = tolerance;
+            request.max_iterations = max_iterations;
+            return call(request);
+        }
+
+        /**
+         * @brief Sends a request
+         */
+        void send(const Request& request){
+            if (::send(sock, &request, sizeof(request), 0) != static_cast<ssize_t>(sizeof(request))) {
+                throw std::runtime_error("Client: cannot send the request.");
+            }
+        }
+
+        /**
+         * @brief Waits for the next reply
+         */
+        Reply receive(){
+            Reply reply;
+            if (recv(sock, &reply, sizeof(reply), 0) != static_cast<ssize_t>(sizeof(reply))) {
+                throw std::runtime_error("Client: connection closed by the server.");
+            }
+            return reply;
+        }
+
+    private:
+        Reply call(const Request& request){
+            send(request);
+            return receive();
+        }
+
+        static void check(const Reply& reply, const std::string& what){
+            if (reply.status != static_cast<std::int32_t>(Status::Ok)) {
+                throw std::runtime_error("Client: " + what + " failed with status " + std::to_string(reply.status));
+            }
+        }
+
+        int sock = -1; //!< connected socket
+        double* buffer = nullptr; //!< shared buffer
+        std::size_t length = 0; //!< size in bytes of the shared buffer
+    };
+
+} // namespace algebra::spmv_service
+
+#endif // SPMV_PROTOCOL_HPP
@@ -0,0 +1,419 @@
+/**
+ * @file spmv_server.cpp
+ * @brief SpMV service: keeps matrices resident and answers multiply/norm/solve requests over a Unix socket.
+ *
+ * Usage:
+ * ```
+ * ./spmv_server <socket path> <name>=<file.mtx> [<name>=shm:<segment>] ...
+ * ```
+ * Matrices given as files are read with Matrix::read and compressed (row ordering); matrices given as
+ * shm:<segment> are attached to a segment published with SharedMatrix::publish (no copy).
+ * The wire format is described in spmv_protocol.hpp.
+ */
+
+#include "shared_matrix.hpp"
+#include "iterative_solvers.hpp"
+#include "spmv_protocol.hpp"
+#include <chrono>
+#include <csignal>
+#include <deque>
+#include <memory>
+#include <poll.h>
+#include <sys/stat.h>
+
+using namespace algebra;
+using namespace algebra::spmv_service;
+
+namespace {
+
+    using ResidentMatrix = Matrix<double, StorageOrder::RowOrdering>;
+    using ResidentView = MatrixView<double, StorageOrder::RowOrdering>;
+
+    /**
+     * @brief A matrix kept in memory by the server
+     */
+    struct Resident {
+        std::string name; //!< name used by the clients
+        std::unique_ptr<ResidentMatrix> owned; //!< matrix read from a file
+        std::unique_ptr<SharedMatrix<double, StorageOrder::RowOrdering>> shared; //!< matrix in shared memory
+        ResidentView view; //!< view used by all the operations
+    };
+
+    /**
+     * @brief A connected client
+     */
+    struct Session {
+        int fd = -1; //!< connected socket
+        double* buffer = nullptr; //!< shared buffer of the client
+        std::size_t size = 0; //!< number of doubles in the buffer
+        std::size_t length = 0; //!< size in bytes of the mapping
+        std::deque<Reply> outgoing; //!< replies not sent yet, because the socket buffer was full
+    };
+
+    /**
+     * @brief A request received in the current round, with its reply
+     */
+    struct Pending {
+        Session* session;
+        Request request;
+        Reply reply;
+    };
+
+    volatile std::sig_atomic_t stop_requested = 0;
+
+    void on_signal(int){
+        stop_requested = 1;
+    }
+
+    // Checks that n doubles starting at offset fit in the buffer of the session
+    bool fits(const Session& session, std::uint64_t offset, std::size_t n){
+        return session.buffer != nullptr && offset <= session.size && n <= session.size - offset;
+    }
+
+    /**
+     * @brief The server: resident matrices, sessions and the request loop
+     */
+    class Server {
+    public:
+        explicit Server(std::vector<Resident>& matrices) : matrices(matrices){};
+
+        // Main loop: waits for requests, executes them by rounds until a signal arrives
+        void run(int listen_fd){
+            std::vector<pollfd> fds;
+            std::vector<Pending> pending;
+            while (!stop_requested) {
+                fds.assign(1, pollfd{listen_fd, POLLIN, 0});
+                for (const auto& session : sessions) {
+                    const short events = session->outgoing.empty() ? POLLIN : POLLIN | POLLOUT;
+                    fds.push_back(pollfd{session->fd, events, 0});
+                }
+                if (poll(fds.data(), fds.size(), -1) < 0) {
+                    continue; // interrupted by a signal
+                }
+                if (fds[0].revents & POLLIN) {
+                    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK);
+                    if (fd >= 0) {
+                        sessions.push_back(std::make_unique<Session>());
+                        sessions.back()->fd = fd;
+                    }
+                }
+
+                // Collect every request already waiting on the sockets
+                pending.clear();
+                for (std::size_t s = 1; s < fds.size(); ++s) {
+                    if (fds[s].revents == 0) {
+                        continue;
+                    }
+                    Session* session = sessions[s - 1].get();
+                    if (fds[s].revents & POLLOUT) {
+                        send_replies(session);
+                        if (session->fd < 0) {
+                            continue;
+                        }
+                    }
+                    Request request;
+                    ssize_t n;
+                    while ((n = recv(session->fd, &request, sizeof(request), MSG_DONTWAIT)) == sizeof(request)) {
+                        pending.push_back({session, request, Reply{}});
+                    }
+                    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) || n > 0) {
+                        disconnect(session);
+                    }
+                }
+
+                execute(pending);
+                for (const auto& p : pending) {
+                    if (p.session->fd >= 0) {
+                        p.session->outgoing.push_back(p.reply);
+                    }
+                }
+                for (const auto& session : sessions) {
+                    if (session->fd >= 0) {
+                        send_replies(session.get());
+                    }
+                }
+                std::erase_if(sessions, [](const auto& session){ return session->fd < 0; });
+            }
+            std::cout << "Served " << served << " requests, " << batched << " multiplications in "
+                      << batches << " SpMM batches." << std::endl;
+        }
+
+    private:
+        // Executes a round in the order of arrival. Multiply requests on the same matrix are batched in one SpMM;
+        // the batches are flushed before a product that depends on a pending one of the same client (y = A*x; z = A*y,
+        // see conflicts_with_pending), before a Solve and before a Hello, which replaces the buffer. Replies and
+        // results are those of executing the requests of each client one by one
+        void execute(std::vector<Pending>& pending){
+            std::map<std::uint32_t, std::vector<Pending*>> products;
+            auto flush = [&]{
+                for (auto& [id, group] : products) {
+                    multiply(matrices[id].view, group);
+                }
+                products.clear();
+            };
+            for (auto& p : pending) {
+                ++served;
+                const auto op = static_cast<Operation>(p.request.operation);
+                if (p.session->fd < 0) {
+                    continue;
+                }
+                if (op != Operation::Hello && op != Operation::Lookup && p.request.matrix >= matrices.size()) {
+                    p.reply.status = static_cast<std::int32_t>(Status::UnknownMatrix);
+                    continue;
+                }
+                switch (op) {
+                    case Operation::Hello: flush(); hello(p); break;
+                    case Operation::Lookup: lookup(p); break;
+                    case Operation::Multiply: {
+                        const auto& A = matrices[p.request.matrix].view;
+                        if (!fits(*p.session, p.request.input, A.cols()) || !fits(*p.session, p.request.output, A.rows())) {
+                            p.reply.status = static_cast<std::int32_t>(Status::OutOfBuffer);
+                            break;
+                        }
+                        if (conflicts_with_pending(products, p)) {
+                            flush();
+                        }
+                        products[p.request.matrix].push_back(&p);
+                        break;
+                    }
+                    case Operation::Norm: {
+                        const auto& A = matrices[p.request.matrix].view;
+                        switch (p.request.parameter) {
+                            case 0: p.reply.value = A.norm<NormType::One>(); break;
+                            case 1: p.reply.value = A.norm<NormType::Infinity>(); break;
+                            case 2: p.reply.value = A.norm<NormType::Frobenius>(); break;
+                            default: p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                        }
+                        break;
+                    }
+                    case Operation::Solve: flush(); solve(p); break;
+                    default: p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                }
+            }
+            flush();
+        }
+
+        // Checks whether a Multiply must wait for the pending products of the same client: its input overlaps a
+        // pending output, or its output overlaps a vector of a pending product of another matrix (the batches of
+        // different matrices run one after the other). Within a batch all the inputs are read before any output
+        // is written, and the outputs are written in the order of arrival
+        bool conflicts_with_pending(const std::map<std::uint32_t, std::vector<Pending*>>& products, const Pending& p) const{
+            const std::size_t m = matrices[p.request.matrix].view.rows(), n = matrices[p.request.matrix].view.cols();
+            auto overlap = [](std::uint64_t first1, std::size_t size1, std::uint64_t first2, std::size_t size2){
+                return first1 < first2 + size2 && first2 < first1 + size1;
+            };
+            for (const auto& [id, group] : products) {
+                const std::size_t group_m = matrices[id].view.rows(), group_n = matrices[id].view.cols();
+                for (const Pending* q : group) {
+                    if (q->session != p.session) {
+                        continue;
+                    }
+                    if (overlap(p.request.input, n, q->request.output, group_m)) {
+                        return true;
+                    }
+                    if (id != p.request.matrix && (overlap(p.request.output, m, q->request.output, group_m) ||
+                                                   overlap(p.request.output, m, q->request.input, group_n))) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        // Maps the shared buffer of the client, after checking that the segment is as large as claimed
+        void hello(Pending& p){
+            Session& session = *p.session;
+            p.request.name[sizeof(p.request.name) - 1] = '\0';
+            int fd = shm_open(p.request.name, O_RDWR, 0);
+            if (fd < 0) {
+                p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) != 0 || p.request.size == 0 || p.request.size > static_cast<std::uint64_t>(st.st_size)) {
+                close(fd);
+                p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                return;
+            }
+            void* ptr = mmap(nullptr, p.request.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (ptr == MAP_FAILED) {
+                p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                return;
+            }
+            if (session.buffer != nullptr) {
+                munmap(session.buffer, session.length);
+            }
+            session.buffer = static_cast<double*>(ptr);
+            session.length = p.request.size;
+            session.size = p.request.size / sizeof(double);
+        }
+
+        // Finds a matrix by name
+        void lookup(Pending& p){
+            p.request.name[sizeof(p.request.name) - 1] = '\0';
+            for (std::size_t id = 0; id < matrices.size(); ++id) {
+                if (matrices[id].name == p.request.name) {
+                    p.reply.matrix = static_cast<std::uint32_t>(id);
+                    p.reply.rows = matrices[id].view.rows();
+                    p.reply.cols = matrices[id].view.cols();
+                    return;
+                }
+            }
+            p.reply.status = static_cast<std::int32_t>(Status::UnknownMatrix);
+        }
+
+        // Computes a batch of products of a matrix. The results go to a work vector first, so that an output
+        // may overlap an input (even of the same request)
+        void multiply(const ResidentView& A, const std::vector<Pending*>& group){
+            const std::size_t m = A.rows();
+            const std::size_t n = A.cols();
+            if (group.size() == 1) {
+                const Pending& p = *group.front();
+                block_out.assign(m, 0.0);
+                compressed_multiply<double, StorageOrder::RowOrdering>(A.inner_index(), A.outer_index(), A.values(),
+                    std::span<const double>(p.session->buffer + p.request.input, n), block_out);
+                std::copy(block_out.begin(), block_out.end(), p.session->buffer + p.request.output);
+                return;
+            }
+            // Gather the inputs in a block stored by rows, one SpMM, scatter the outputs
+            const std::size_t nvec = group.size();
+            block_in.assign(n * nvec, 0.0);
+            for (std::size_t v = 0; v < nvec; ++v) {
+                const double* x = group[v]->session->buffer + group[v]->request.input;
+                for (std::size_t j = 0; j < n; ++j) {
+                    block_in[j * nvec + v] = x[j];
+                }
+            }
+            block_out.assign(m * nvec, 0.0);
+            compressed_multiply_block<double, StorageOrder::RowOrdering>(A.inner_index(), A.outer_index(), A.values(),
+                                                                          block_in, nvec, block_out);
+            for (std::size_t v = 0; v < nvec; ++v) {
+                double* y = group[v]->session->buffer + group[v]->request.output;
+                for (std::size_t i = 0; i < m; ++i) {
+                    y[i] = block_out[i * nvec + v];
+                }
+            }
+            ++batches;
+            batched += nvec;
+        }
+
+        // Solves a linear system with CG or GMRES
+        void solve(Pending& p){
+            const auto& A = matrices[p.request.matrix].view;
+            Session& session = *p.session;
+            if (p.request.parameter > 1) {
+                p.reply.status = static_cast<std::int32_t>(Status::BadRequest);
+                return;
+            }
+            if (A.rows() != A.cols() || !fits(session, p.request.input, A.rows()) || !fits(session, p.request.output, A.rows())) {
+                p.reply.status = static_cast<std::int32_t>(Status::OutOfBuffer);
+                return;
+            }
+            std::vector<double> b(session.buffer + p.request.input, session.buffer + p.request.input + A.rows());
+            std::vector<double> x(session.buffer + p.request.output, session.buffer + p.request.output + A.rows());
+            SolverResult result = p.request.parameter == 0
+                ? cg(A, b, x, p.request.tolerance, p.request.max_iterations)
+                : gmres(A, b, x, p.request.tolerance, p.request.max_iterations);
+            std::copy(x.begin(), x.end(), session.buffer + p.request.output);
+            p.reply.iterations = result.iterations;
+            p.reply.value = result.residual;
+            if (!result.converged) {
+                p.reply.status = static_cast<std::int32_t>(Status::NotConverged);
+            }
+        }
+
+        // Sends the queued replies of a client, in order, until its socket buffer is full: the rest is sent
+        // when poll reports the socket writable again
+        void send_replies(Session* session){
+            while (!session->outgoing.empty()) {
+                const ssize_t n = send(session->fd, &session->outgoing.front(), sizeof(Reply), MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (n == static_cast<ssize_t>(sizeof(Reply))) {
+                    session->outgoing.pop_front();
+                } else {
+                    if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        disconnect(session);
+                    }
+                    return;
+                }
+            }
+        }
+
+        // Closes the connection and unmaps the buffer of a client
+        void disconnect(Session* session){
+            close(session->fd);
+            session->fd = -1;
+            session->outgoing.clear();
+            if (session->buffer != nullptr) {
+                munmap(session->buffer, session->length);
+                session->buffer = nullptr;
+            }
+        }
+
+        std::vector<Resident>& matrices; //!< resident matrices, the id is the position
+        std::vector<std::unique_ptr<Session>> sessions; //!< connected clients
+        std::vector<double> block_in, block_out; //!< work space of the batched products
+        std::size_t served = 0, batched = 0, batches = 0; //!< statistics
+    };
+
+} // namespace
+
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <socket path> <name>=<file.mtx>|<name>=shm:<segment> ..." << std::endl;
+        return 1;
+    }
+    const std::string socket_path = argv[1];
+
+    // Load the matrices
+    std::vector<Resident> matrices;
+    matrices.reserve(argc - 2);
+    for (int a = 2; a < argc; ++a) {
+        const std::string spec = argv[a];
+        const auto eq = spec.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "Invalid matrix specification: " << spec << std::endl;
+            return 1;
+        }
+        const std::string name = spec.substr(0, eq);
+        const std::string source = spec.substr(eq + 1);
+        if (source.rfind("shm:", 0) == 0) {
+            auto shared = std::make_unique<SharedMatrix<double, StorageOrder::RowOrdering>>(
+                SharedMatrix<double, StorageOrder::RowOrdering>::attach(source.substr(4)));
+            ResidentView view = shared->view();
+            matrices.push_back(Resident{name, nullptr, std::move(shared), view});
+        } else {
+            auto owned = std::make_unique<ResidentMatrix>(0, 0);
+            owned->read(source);
+            owned->compress();
+            ResidentView view(*owned);
+            matrices.push_back(Resident{name, std::move(owned), nullptr, view});
+        }
+        std::cout << "Resident matrix " << matrices.size() - 1 << ": " << name << std::endl;
+    }
+
+    // Listen on the socket
+    int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "Cannot listen on " << socket_path << std::endl;
+        return 1;
+    }
+
+    struct sigaction action{};
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Listening on " << socket_path << std::endl;
+    Server server(matrices);
+    server.run(listen_fd);
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
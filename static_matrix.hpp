@@ -0,0 +1,237 @@
+/**
+ * @file static_matrix.hpp
+ * @brief Contains StaticSparseMatrix, a small sparse matrix whose size and sparsity pattern are template parameters.
+ *
+ * Element matrices, local stencils and other tiny operators are applied millions of times with a pattern known
+ * at compile time. A StaticSparseMatrix stores only the values, in a std::array; the positions of the entries
+ * are constants of the type, so the matrix-vector product is unrolled entry by entry and reads no index.
+ * Everything is constexpr, and the matrices can be added into (or read from) a Matrix during assembly.
+ */
+
+#ifndef STATIC_MATRIX_HPP
+#define STATIC_MATRIX_HPP
+
+#include "sparse_matrix.hpp"
+
+namespace algebra {
+
+    /**
+     * @brief Compile-time sparsity pattern in CSR format, usable as a template parameter
+     *
+     * @tparam Rows Number of rows
+     * @tparam NNZ Number of entries
+     */
+    template<std::size_t Rows, std::size_t NNZ>
+    struct StaticPattern {
+        std::array<std::size_t, Rows + 1> row_ptr{}; //!< first entry of each row, plus the total
+        std::array<std::size_t, NNZ> columns{}; //!< column of each entry, sorted within each row
+
+        /**
+         * @brief Position of the entry (i, j) in the values, or NNZ if it is not in the pattern
+         */
+        constexpr std::size_t position(std::size_t i, std::size_t j) const{
+            for (std::size_t k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+                if (columns[k] == j) {
+                    return k;
+                }
+            }
+            return NNZ;
+        }
+    };
+
+    /**
+     * @brief Builds a StaticPattern from a list of (row, column) entries, in any order.
+     * In a constant expression, an invalid list (entry out of bounds, repeated entry) is a compile error.
+     *
+     * @tparam Rows Number of rows
+     * @tparam Cols Number of columns
+     * @param entries The (row, column) positions of the entries
+     */
+    template<std::size_t Rows, std::size_t Cols, std::size_t NNZ>
+    constexpr StaticPattern<Rows, NNZ> make_static_pattern(std::array<std::array<std::size_t, 2>, NNZ> entries){
+        std::sort(entries.begin(), entries.end());
+        StaticPattern<Rows, NNZ> pattern;
+        for (std::size_t k = 0; k < NNZ; ++k) {
+            if (entries[k][0] >= Rows || entries[k][1] >= Cols) {
+                throw std::out_of_range("Entry out of the matrix bounds.");
+            }
+            if (k > 0 && entries[k] == entries[k - 1]) {
+                throw std::invalid_argument("Repeated entry in the pattern.");
+            }
+            ++pattern.row_ptr[entries[k][0] + 1];
+            pattern.columns[k] = entries[k][1];
+        }
+        for (std::size_t i = 0; i < Rows; ++i) {
+            pattern.row_ptr[i + 1] += pattern.row_ptr[i];
+        }
+        return pattern;
+    }
+
+    /**
+     * @brief Builds the pattern of a dense Rows x Cols matrix
+     */
+    template<std::size_t Rows, std::size_t Cols>
+    constexpr StaticPattern<Rows, Rows * Cols> dense_static_pattern(){
+        StaticPattern<Rows, Rows * Cols> pattern;
+        for (std::size_t i = 0; i < Rows; ++i) {
+            pattern.row_ptr[i + 1] = (i + 1) * Cols;
+            for (std::size_t j = 0; j < Cols; ++j) {
+                pattern.columns[i * Cols + j] = j;
+            }
+        }
+        return pattern;
+    }
+
+    /**
+     * @brief Sparse matrix of fixed size and fixed sparsity pattern; only the values are stored.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Rows Number of rows
+     * @tparam Cols Number of columns
+     * @tparam Pattern The sparsity pattern, a StaticPattern<Rows, NNZ> (see make_static_pattern)
+     */
+    template<RealOrComplex T, std::size_t Rows, std::size_t Cols, auto Pattern>
+    class StaticSparseMatrix {
+    public:
+        static_assert(Pattern.row_ptr.size() == Rows + 1, "The pattern must have Rows rows.");
+
+        static constexpr std::size_t NNZ = Pattern.columns.size(); //!< number of entries of the pattern
+
+        /**
+         * @brief Default constructor: all the entries of the pattern are 0
+         */
+        constexpr StaticSparseMatrix() = default;
+
+        /**
+         * @brief Constructor from the values of the entries, in the order of the pattern (by rows, then columns)
+         */
+        constexpr explicit StaticSparseMatrix(const std::array<T, NNZ>& values) : data(values){}
+
+        /**
+         * @brief Constructor: reads the entries of the pattern from a Matrix (compressed or not) of the same size;
+         * the other elements of the matrix are ignored
+         */
+        template<StorageOrder Order>
+        explicit StaticSparseMatrix(const Matrix<T, Order>& matrix){
+            if (matrix.rows() != Rows || matrix.cols() != Cols) {
+                throw std::invalid_argument("Matrix dimensions mismatch.");
+            }
+            for (std::size_t i = 0; i < Rows; ++i) {
+                for (std::size_t k = Pattern.row_ptr[i]; k < Pattern.row_ptr[i + 1]; ++k) {
+                    data[k] = matrix(i, Pattern.columns[k]);
+                }
+            }
+        }
+
+        /**
+         * @brief Const access to the element (i, j); returns 0 if it is not in the pattern
+         */
+        constexpr T operator()(std::size_t i, std::size_t j) const{
+            if (i >= Rows || j >= Cols) {
+                throw std::out_of_range("Index out of boundary");
+            }
+            const std::size_t k = Pattern.position(i, j);
+            return k < NNZ ? data[k] : T{0};
+        }
+
+        /**
+         * @brief Access to the entry (I, J) of the pattern; the position is resolved at compile time
+         */
+        template<std::size_t I, std::size_t J>
+        constexpr T& entry(){
+            constexpr std::size_t k = Pattern.position(I, J);
+            static_assert(k < NNZ, "The entry is not in the pattern.");
+            return data[k];
+        }
+
+        /**
+         * @brief Const access to the entry (I, J) of the pattern; the position is resolved at compile time
+         */
+        template<std::size_t I, std::size_t J>
+        constexpr const T& entry() const{
+            constexpr std::size_t k = Pattern.position(I, J);
+            static_assert(k < NNZ, "The entry is not in the pattern.");
+            return data[k];
+        }
+
+        /**
+         * @brief Matrix-vector product, unrolled: every entry is a multiply-add with constant positions
+         */
+        constexpr std::array<T, Rows> operator*(const std::array<T, Cols>& x) const{
+            std::array<T, Rows> y{};
+            multiply_rows(x.data(), y.data(), std::make_index_sequence<Rows>{});
+            return y;
+        }
+
+        /**
+         * @brief Matrix-vector product with run-time vectors (e.g. slices of a global vector)
+         *
+         * @param x Vector of Cols entries
+         * @param y Vector of Rows entries receiving the product
+         */
+        constexpr void multiply(std::span<const T, Cols> x, std::span<T, Rows> y) const{
+            multiply_rows(x.data(), y.data(), std::make_index_sequence<Rows>{});
+        }
+
+        /**
+         * @brief Assembly: adds the matrix into a larger Matrix in uncompressed format,
+         * entry (i, j) going to (row_dofs[i], col_dofs[j])
+         *
+         * @param global The matrix being assembled
+         * @param row_dofs Row of global of each row
+         * @param col_dofs Column of global of each column
+         */
+        template<StorageOrder Order>
+        void add_to(Matrix<T, Order>& global, const std::array<std::size_t, Rows>& row_dofs,
+                    const std::array<std::size_t, Cols>& col_dofs) const{
+            for (std::size_t i = 0; i < Rows; ++i) {
+                for (std::size_t k = Pattern.row_ptr[i]; k < Pattern.row_ptr[i + 1]; ++k) {
+                    global(row_dofs[i], col_dofs[Pattern.columns[k]]) += data[k];
+                }
+            }
+        }
+
+        /**
+         * @brief Converts the matrix into a compressed Matrix
+         */
+        template<StorageOrder Order = StorageOrder::RowOrdering>
+        Matrix<T, Order> to_matrix() const{
+            Matrix<T, Order> matrix(Rows, Cols);
+            for (std::size_t i = 0; i < Rows; ++i) {
+                for (std::size_t k = Pattern.row_ptr[i]; k < Pattern.row_ptr[i + 1]; ++k) {
+                    matrix(i, Pattern.columns[k]) = data[k];
+                }
+            }
+            matrix.compress();
+            return matrix;
+        }
+
+        /**
+         * @brief Utility: values of the entries, in the order of the pattern
+         */
+        constexpr std::span<T, NNZ> values(){ return data;};
+        constexpr std::span<const T, NNZ> values() const{ return data;};
+
+        static constexpr std::size_t rows(){ return Rows;};
+        static constexpr std::size_t cols(){ return Cols;};
+        static constexpr std::size_t nonzeros(){ return NNZ;};
+
+    private:
+        // One fold expression per row: the positions of the entries are template arguments
+        template<std::size_t I, std::size_t... K>
+        constexpr T row_product(const T* x, std::index_sequence<K...>) const{
+            constexpr std::size_t first = Pattern.row_ptr[I];
+            return (T{0} + ... + (data[first + K] * x[Pattern.columns[first + K]]));
+        }
+
+        template<std::size_t... I>
+        constexpr void multiply_rows(const T* x, T* y, std::index_sequence<I...>) const{
+            ((y[I] = row_product<I>(x, std::make_index_sequence<Pattern.row_ptr[I + 1] - Pattern.row_ptr[I]>{})), ...);
+        }
+
+        std::array<T, NNZ> data{}; //!< values of the entries, in the order of the pattern
+    };
+
+} // namespace algebra
+
+#endif // STATIC_MATRIX_HPP
@@ -0,0 +1,326 @@
+/**
+ * @file vector_expressions.hpp
+ * @brief Contains lazy vector expressions (expression templates) fusing a matrix-vector product with the
+ * element-wise operations that follow it.
+ *
+ * Writing y = A*x; z = y + alpha*w; r = b - z allocates and traverses one temporary vector per step.
+ * With the expressions of this file the same computation is written
+ *
+ *     std::vector<double> r = b - (lazy(A) * x + alpha * lazy(w));
+ *
+ * and nothing is computed until the expression is assigned: then a single loop over the rows computes, for
+ * every i, the dot product of row i of A with x and combines it with w[i] and b[i]. No temporary is allocated
+ * and every vector is traversed once. The loop runs on the evaluator of the expression, a callable built once
+ * that holds the pointers of all the operands.
+ */
+
+#ifndef VECTOR_EXPRESSIONS_HPP
+#define VECTOR_EXPRESSIONS_HPP
+
+#include "matrix_view.hpp"
+#include <optional>
+#include <memory>
+
+namespace algebra {
+
+    /**
+     * @brief Concept satisfied by the lazy expressions of this file: they know their size and give an evaluator,
+     * a small callable computing their i-th entry
+     */
+    template<typename E>
+    concept VectorExpression = requires(const E& e, std::size_t i) {
+        typename E::value_type;
+        { E::is_vector_expression } -> std::convertible_to<bool>;
+        { e.size() } -> std::convertible_to<std::size_t>;
+        { e.evaluator()(i) } -> std::convertible_to<typename E::value_type>;
+    };
+
+    /**
+     * @brief Base of the expressions: entry access and conversion to std::vector, i.e. evaluation in one pass.
+     *
+     * The evaluation loop works on a local copy of the evaluator of the expression, which holds the pointers
+     * of all the operands by value: they stay in registers for the whole loop instead of being reloaded
+     * through the nodes of the expression at every entry.
+     *
+     * @tparam Derived The expression type
+     * @tparam T The type of the entries
+     */
+    template<typename Derived, typename T>
+    struct ExpressionBase {
+        using value_type = T;
+        static constexpr bool is_vector_expression = true;
+
+        /**
+         * @brief Entry i of the expression (to evaluate many entries use evaluator() once)
+         */
+        T operator[](std::size_t i) const{ return static_cast<const Derived&>(*this).evaluator()(i);};
+
+        /**
+         * @brief Evaluates the expression into a new vector
+         */
+        operator std::vector<T>() const{
+            const Derived& self = static_cast<const Derived&>(*this);
+            std::vector<T> result(self.size());
+            const auto entry = self.evaluator();
+            T* out = result.data();
+            const std::size_t n = result.size();
+            for (std::size_t i = 0; i < n; ++i) {
+                out[i] = entry(i);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * @brief Leaf of an expression: a reference to an existing vector, which must outlive the expression
+     */
+    template<typename T>
+    class VectorOperand : public ExpressionBase<VectorOperand<T>, T> {
+    public:
+        explicit VectorOperand(std::span<const T> v) : v(v){};
+        std::size_t size() const{ return v.size();};
+        auto evaluator() const{ return [v = v.data()](std::size_t i){ return v[i];};}
+
+    private:
+        std::span<const T> v; //!< the referenced vector
+    };
+
+    /**
+     * @brief Lazy product of a row ordered compressed matrix with x: entry i is the dot product of row i with x,
+     * computed when the expression is evaluated, in the same pass as the rest of the expression
+     */
+    template<typename T>
+    class RowProductExpression : public ExpressionBase<RowProductExpression<T>, T> {
+    public:
+        /**
+         * @brief Constructor: the arrays of the view and x must outlive the expression
+         */
+        RowProductExpression(const MatrixView<T, StorageOrder::RowOrdering>& A, std::span<const T> x)
+            : inner(A.inner_index()), outer(A.outer_index()), data(A.values()), x(x), numrows(A.rows()){
+            if (A.cols() != x.size()) {
+                throw std::invalid_argument("Matrix-vector dimensions mismatch.");
+            }
+        };
+
+        /**
+         * @brief Constructor: A and x must outlive the expression. A matrix that is not compressed with plain
+         * values is compressed and decoded into a copy owned by the expression (see LazyMatrix)
+         */
+        RowProductExpression(const Matrix<T, StorageOrder::RowOrdering>& A, std::span<const T> x)
+            : RowProductExpression(plain_copy(A), A, x){};
+
+        std::size_t size() const{ return numrows;};
+
+        auto evaluator() const{
+            return [inner = inner.data(), outer = outer, data = data.data(), x = x](std::size_t i){
+                // Same summation order as operator* (see compressed_row_dot)
+                return compressed_row_dot<T>(inner[i], inner[i + 1], outer, [data](std::size_t k){ return data[k];}, x);
+            };
+        }
+
+    private:
+        // Compressed copy of A with plain values, nullptr if A is already compressed with plain values
+        static std::shared_ptr<const Matrix<T, StorageOrder::RowOrdering>> plain_copy(const Matrix<T, StorageOrder::RowOrdering>& A){
+            if (A.is_compressed() && A.encoding() == ValueEncoding::Plain) {
+                return nullptr;
+            }
+            auto copy = std::make_shared<Matrix<T, StorageOrder::RowOrdering>>(A);
+            copy->compress();
+            copy->decode();
+            return copy;
+        }
+
+        RowProductExpression(std::shared_ptr<const Matrix<T, StorageOrder::RowOrdering>> copy,
+                             const Matrix<T, StorageOrder::RowOrdering>& A, std::span<const T> x)
+            : RowProductExpression(copy ? MatrixView<T, StorageOrder::RowOrdering>(*copy) : MatrixView<T, StorageOrder::RowOrdering>(A), x){
+            owned = std::move(copy);
+        }
+
+        std::shared_ptr<const Matrix<T, StorageOrder::RowOrdering>> owned; //!< compressed copy of the matrix, if needed
+        std::span<const std::size_t> inner; //!< row pointers
+        std::span<const std::size_t> outer; //!< column indices
+        std::span<const T> data; //!< values
+        std::span<const T> x; //!< the vector multiplied
+        std::size_t numrows; //!< size of the product
+    };
+
+    /**
+     * @brief Matrix-vector product computed when the expression is built, for the matrices that do not give
+     * their rows in one place (column ordering): the rest of the expression is still fused
+     */
+    template<typename T>
+    class ComputedProductExpression : public ExpressionBase<ComputedProductExpression<T>, T> {
+    public:
+        explicit ComputedProductExpression(std::vector<T>&& product)
+            : product(std::make_shared<const std::vector<T>>(std::move(product))){};
+        std::size_t size() const{ return product->size();};
+        auto evaluator() const{ return [v = product->data()](std::size_t i){ return v[i];};}
+
+    private:
+        std::shared_ptr<const std::vector<T>> product; //!< the product, shared by the copies of the node
+    };
+
+    /**
+     * @brief Lazy element-wise sum (Sign = 1) or difference (Sign = -1) of two expressions
+     */
+    template<VectorExpression L, VectorExpression R, int Sign>
+    class SumExpression : public ExpressionBase<SumExpression<L, R, Sign>, typename L::value_type> {
+    public:
+        SumExpression(const L& lhs, const R& rhs) : lhs(lhs), rhs(rhs){
+            if (lhs.size() != rhs.size()) {
+                throw std::invalid_argument("Vector dimensions mismatch.");
+            }
+        };
+        std::size_t size() const{ return lhs.size();};
+        auto evaluator() const{
+            return [l = lhs.evaluator(), r = rhs.evaluator()](std::size_t i){
+                if constexpr (Sign > 0) {
+                    return l(i) + r(i);
+                } else {
+                    return l(i) - r(i);
+                }
+            };
+        }
+
+    private:
+        L lhs; //!< left operand, the nodes are small and held by value
+        R rhs; //!< right operand
+    };
+
+    /**
+     * @brief Lazy product of an expression by a scalar
+     */
+    template<VectorExpression E>
+    class ScaledExpression : public ExpressionBase<ScaledExpression<E>, typename E::value_type> {
+    public:
+        ScaledExpression(const typename E::value_type& alpha, const E& e) : alpha(alpha), e(e){};
+        std::size_t size() const{ return e.size();};
+        auto evaluator() const{ return [alpha = alpha, entry = e.evaluator()](std::size_t i){ return alpha * entry(i);};}
+
+    private:
+        typename E::value_type alpha; //!< the scalar
+        E e; //!< the scaled expression
+    };
+
+    /**
+     * @brief Matrix used in a lazy product: lazy(A) * x gives a ProductExpression
+     */
+    template<RealOrComplex T, StorageOrder Order>
+    class LazyMatrix {
+    public:
+        explicit LazyMatrix(const Matrix<T, Order>& A) : matrix(&A){};
+        explicit LazyMatrix(const MatrixView<T, Order>& A) : view(A){};
+
+        /**
+         * @brief Lazy product with a vector, which must outlive the expression: a RowProductExpression for
+         * row ordering, a ComputedProductExpression for column ordering
+         */
+        auto operator*(const std::vector<T>& x) const{
+            if constexpr (Order == StorageOrder::RowOrdering) {
+                return view ? RowProductExpression<T>(*view, x) : RowProductExpression<T>(*matrix, x);
+            } else {
+                return ComputedProductExpression<T>(view ? *view * x : *matrix * x);
+            }
+        }
+
+    private:
+        const Matrix<T, Order>* matrix = nullptr; //!< the matrix, if any
+        std::optional<MatrixView<T, Order>> view; //!< the view, if any
+    };
+
+    /**
+     * @brief Marks a matrix as the left operand of a lazy product; it must outlive the expression
+     */
+    template<RealOrComplex T, StorageOrder Order>
+    LazyMatrix<T, Order> lazy(const Matrix<T, Order>& A){ return LazyMatrix<T, Order>(A);}
+
+    /**
+     * @brief Marks a view as the left operand of a lazy product; the arrays must outlive the expression
+     */
+    template<RealOrComplex T, StorageOrder Order>
+    LazyMatrix<T, Order> lazy(const MatrixView<T, Order>& A){ return LazyMatrix<T, Order>(A);}
+
+    /**
+     * @brief Makes a vector a leaf of an expression (e.g. alpha * lazy(w)); it must outlive the expression
+     */
+    template<typename T>
+    VectorOperand<T> lazy(const std::vector<T>& v){ return VectorOperand<T>(v);}
+
+    /**
+     * @brief Lazy sum of two expressions
+     */
+    template<VectorExpression L, VectorExpression R>
+    SumExpression<L, R, 1> operator+(const L& lhs, const R& rhs){ return {lhs, rhs};}
+
+    /**
+     * @brief Lazy difference of two expressions
+     */
+    template<VectorExpression L, VectorExpression R>
+    SumExpression<L, R, -1> operator-(const L& lhs, const R& rhs){ return {lhs, rhs};}
+
+    /**
+     * @brief Lazy sum of a vector and an expression
+     */
+    template<VectorExpression E>
+    SumExpression<VectorOperand<typename E::value_type>, E, 1> operator+(const std::vector<typename E::value_type>& v, const E& e){
+        return {lazy(v), e};
+    }
+
+    /**
+     * @brief Lazy sum of an expression and a vector
+     */
+    template<VectorExpression E>
+    SumExpression<E, VectorOperand<typename E::value_type>, 1> operator+(const E& e, const std::vector<typename E::value_type>& v){
+        return {e, lazy(v)};
+    }
+
+    /**
+     * @brief Lazy difference of a vector and an expression (e.g. the residual b - lazy(A) * x)
+     */
+    template<VectorExpression E>
+    SumExpression<VectorOperand<typename E::value_type>, E, -1> operator-(const std::vector<typename E::value_type>& v, const E& e){
+        return {lazy(v), e};
+    }
+
+    /**
+     * @brief Lazy difference of an expression and a vector
+     */
+    template<VectorExpression E>
+    SumExpression<E, VectorOperand<typename E::value_type>, -1> operator-(const E& e, const std::vector<typename E::value_type>& v){
+        return {e, lazy(v)};
+    }
+
+    /**
+     * @brief Lazy product of a scalar and an expression
+     */
+    template<VectorExpression E>
+    ScaledExpression<E> operator*(const typename E::value_type& alpha, const E& e){ return {alpha, e};}
+
+    /**
+     * @brief Evaluates an expression into an existing vector, reusing its storage.
+     * The target must not be the vector of a lazy product in the expression (it would be read while written);
+     * it may appear as an element-wise operand, e.g. assign(x, x + alpha * lazy(p)).
+     *
+     * @param target The vector receiving the result, resized if needed
+     * @param e The expression
+     */
+    template<VectorExpression E>
+    void assign(std::vector<typename E::value_type>& target, const E& e){
+        const std::size_t n = e.size();
+        target.resize(n);
+        const auto entry = e.evaluator();
+        typename E::value_type* out = target.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            out[i] = entry(i);
+        }
+    }
+
+    /**
+     * @brief Evaluates an expression into a new vector
+     */
+    template<VectorExpression E>
+    std::vector<typename E::value_type> evaluate(const E& e){ return e;}
+
+} // namespace algebra
+
+#endif // VECTOR_EXPRESSIONS_HPP
@@ -0,0 +1,176 @@
+/**
+ * @file versioned_matrix.hpp
+ * @brief Contains VersionedMatrix, a matrix updated by writers while readers use it without locking (RCU).
+ */
+
+#ifndef VERSIONED_MATRIX_HPP
+#define VERSIONED_MATRIX_HPP
+
+#include "sparse_matrix.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace algebra {
+
+    /**
+     * @brief Handle to a matrix that is periodically updated while many threads read it (read-copy-update).
+     *
+     * Readers obtain the current version with read(): no lock is taken, the reader announces the epoch it
+     * entered in a slot, loads the version pointer and keeps it until the guard is destroyed.
+     * Writers (serialized among themselves) build the next version from the current one, publish it with an
+     * atomic pointer swap and retire the old version: a retired version is deleted when no reader entered
+     * before the swap is still active (epoch-based reclamation).
+     * The next version starts as a copy-on-write copy of the current one, so an update that only changes
+     * values shares the sparsity pattern and copies only the values.
+     *
+     * @tparam T The type of elements in the matrix
+     * @tparam Order The storage order of the matrix
+     */
+    template<RealOrComplex T, StorageOrder Order >
+    class VersionedMatrix {
+    public:
+        /**
+         * @brief Read access to one version of the matrix: the version stays alive as long as the guard
+         */
+        class ReadGuard {
+        public:
+            ReadGuard(const ReadGuard&) = delete;
+            ReadGuard& operator=(const ReadGuard&) = delete;
+            ReadGuard(ReadGuard&& other) noexcept : slot(other.slot), matrix(other.matrix){ other.slot = nullptr;};
+            ReadGuard& operator=(ReadGuard&&) = delete;
+
+            /**
+             * @brief Destructor: leaves the epoch, the version may then be reclaimed
+             */
+            ~ReadGuard(){
+                if (slot != nullptr) {
+                    slot->store(0, std::memory_order_release);
+                }
+            }
+
+            const Matrix<T, Order>& operator*() const{ return *matrix;};
+            const Matrix<T, Order>* operator->() const{ return matrix;};
+
+        private:
+            friend class VersionedMatrix;
+            ReadGuard(std::atomic<std::uint64_t>* slot, const Matrix<T, Order>* matrix) : slot(slot), matrix(matrix){};
+
+            std::atomic<std::uint64_t>* slot; //!< epoch slot held by the reader
+            const Matrix<T, Order>* matrix; //!< the version being read
+        };
+
+        /**
+         * @brief Constructor
+         *
+         * @param initial First version of the matrix
+         * @param max_readers Maximum number of concurrent readers (further readers wait for a free slot), at least 1
+         */
+        explicit VersionedMatrix(Matrix<T, Order> initial, std::size_t max_readers = 128)
+            : current(new Matrix<T, Order>(std::move(initial))), slots(std::make_unique<Slot[]>(std::max<std::size_t>(max_readers, 1))),
+              num_slots(std::max<std::size_t>(max_readers, 1)){};
+
+        VersionedMatrix(const VersionedMatrix&) = delete;
+        VersionedMatrix& operator=(const VersionedMatrix&) = delete;
+
+        /**
+         * @brief Destructor: no reader must be active
+         */
+        ~VersionedMatrix(){ delete current.load();};
+
+        /**
+         * @brief Lock-free read access to the current version
+         */
+        ReadGuard read() const{
+            // Announce the epoch, then load the version: a writer that swaps the pointer afterwards
+            // sees the announcement and keeps the old version alive
+            std::size_t idx = std::hash<std::thread::id>{}(std::this_thread::get_id()) % num_slots;
+            while (true) {
+                for (std::size_t k = 0; k < num_slots; ++k, idx = (idx + 1) % num_slots) {
+                    std::uint64_t expected = 0;
+                    if (slots[idx].epoch.compare_exchange_strong(expected, epoch.load())) {
+                        return ReadGuard(&slots[idx].epoch, current.load());
+                    }
+                }
+                std::this_thread::yield(); // all the slots are busy
+            }
+        }
+
+        /**
+         * @brief Builds and publishes a new version: the update receives a (copy-on-write) copy of the current
+         * version and modifies it, e.g. through the call operator or values()
+         *
+         * @param modify Callable taking a Matrix<T, Order>&
+         * @return std::uint64_t Number of the new version
+         */
+        template<typename Update>
+        std::uint64_t update(Update&& modify){
+            std::lock_guard<std::mutex> lock(writer);
+            auto next = std::make_unique<Matrix<T, Order>>(*current.load());
+            std::forward<Update>(modify)(*next);
+            return publish_locked(std::move(next));
+        }
+
+        /**
+         * @brief Publishes a new version replacing the current one
+         *
+         * @param matrix The new version
+         * @return std::uint64_t Number of the new version
+         */
+        std::uint64_t publish(Matrix<T, Order> matrix){
+            std::lock_guard<std::mutex> lock(writer);
+            return publish_locked(std::make_unique<Matrix<T, Order>>(std::move(matrix)));
+        }
+
+        /**
+         * @brief Utility: number of the current version (0 for the initial one)
+         */
+        std::uint64_t version() const{ return versions.load();};
+
+        /**
+         * @brief Utility: number of old versions not reclaimed yet (still possibly in use by readers)
+         */
+        std::size_t retired_versions() const{
+            std::lock_guard<std::mutex> lock(writer);
+            return retired.size();
+        }
+
+    private:
+        // Epoch slot of a reader, on its own cache line; 0 means free
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> epoch{0};
+        };
+
+        // Swaps the version pointer, retires the old version and frees the versions no reader can hold
+        std::uint64_t publish_locked(std::unique_ptr<Matrix<T, Order>> next){
+            std::unique_ptr<const Matrix<T, Order>> old(current.exchange(next.release()));
+            // Readers entering from now on announce at least retire_epoch and see the new version
+            const std::uint64_t retire_epoch = epoch.fetch_add(1) + 1;
+            retired.emplace_back(retire_epoch, std::move(old));
+
+            std::uint64_t oldest = retire_epoch;
+            for (std::size_t k = 0; k < num_slots; ++k) {
+                const std::uint64_t e = slots[k].epoch.load();
+                if (e != 0) {
+                    oldest = std::min(oldest, e);
+                }
+            }
+            std::erase_if(retired, [oldest](const auto& version){ return version.first <= oldest;});
+            return versions.fetch_add(1) + 1;
+        }
+
+        std::atomic<const Matrix<T, Order>*> current; //!< the version seen by new readers
+        std::atomic<std::uint64_t> epoch{1}; //!< global epoch, incremented by every publication
+        std::atomic<std::uint64_t> versions{0}; //!< number of publications
+        std::unique_ptr<Slot[]> slots; //!< epochs announced by the active readers
+        std::size_t num_slots; //!< number of reader slots
+        mutable std::mutex writer; //!< serializes the writers
+        std::vector<std::pair<std::uint64_t, std::unique_ptr<const Matrix<T, Order>>>> retired; //!< old versions and their retire epoch
+    };
+
+} // namespace algebra
+
+#endif // VERSIONED_MATRIX_HPP